@@ -1,7 +1,7 @@
 #!/usr/bin/env bash
 
 # Install build dependencies for CI
-# Usage: .ci/install-deps.sh [posix|cortex-m|format|analysis]
+# Usage: .ci/install-deps.sh [posix|cortex-m|riscv|format|analysis]
 
 set -euo pipefail
 
@@ -53,6 +53,17 @@ case "$MODE" in
             gcc-arm-none-eabi libnewlib-arm-none-eabi \
             qemu-system-arm python3
         ;;
+    riscv)
+        # RISC-V QEMU builds: bare-metal cross-compiler, picolibc + emulator.
+        if [ "$OS_TYPE" != "Linux" ]; then
+            print_error "RISC-V CI only supported on Linux"
+            exit 1
+        fi
+        sudo apt-get update -q=2
+        sudo apt-get install -y -q=2 --no-install-recommends \
+            gcc-riscv64-unknown-elf picolibc-riscv64-unknown-elf \
+            qemu-system-misc python3
+        ;;
     format)
         if [ "$OS_TYPE" != "Linux" ]; then
             print_error "Formatting tools only supported on Linux"
@@ -75,7 +86,7 @@ case "$MODE" in
         ;;
     *)
         print_error "Unknown mode: $MODE"
-        echo "Usage: $0 [posix|cortex-m|format|analysis]"
+        echo "Usage: $0 [posix|cortex-m|riscv|format|analysis]"
         exit 1
         ;;
 esac
@@ -56,25 +56,73 @@ extern int tm_test_cycles;
 /* Report helpers and tiny printf implemented in src/tm_report.c.
  * tm_putchar() is the only function each porting layer must supply
  * for console output; tm_printf() calls it internally.
+ * tm_print_fixed2() prints a value in hundredths with two decimals.
  */
 void tm_report_init(void);
 void tm_report_init_argv(int argc, char **argv);
+void tm_report_start(void);
+void tm_report_period(unsigned long total);
+int tm_report_counted(void);
 void tm_report_finish(void);
 void tm_check_fail(const char *msg);
 void tm_putchar(int c);
 void tm_printf(const char *fmt, ...);
+void tm_print_fixed2(unsigned long hundredths);
+
+/* Optional porting-layer hook: print port-specific run statistics (tick
+ * accuracy and the like), cumulative since start-up.  Called from
+ * tm_report_period() once per reporting interval, so unbounded runs show
+ * them too; tm_report.c provides a weak no-op default.
+ */
+void tm_port_report(void);
+
+/* Optional porting-layer hook: peak stack usage of a thread created by
+ * tm_thread_create(), in bytes, and the size of its stack.  Returns
+ * TM_ERROR when the thread does not exist or the port cannot tell (the
+ * host ports run threads on pthread stacks).  tm_report_period() calls
+ * it for each thread id once per reporting interval; tm_report.c
+ * provides a weak default.
+ */
+int tm_thread_stack_usage(int thread_id,
+                          unsigned long *used,
+                          unsigned long *size);
+
+/* Cold-boot time (TM_BOOT_TIME, Cortex-M targets only).  The startup
+ * code starts the tm_timestamp() counter at reset; each port's thread
+ * entry shim calls tm_report_boot_mark(), and the first call records the
+ * count.  tm_report_start() prints it.
+ */
+void tm_report_boot_mark(void);
+
+/* Storage a porting layer fully initialises before use (thread stacks,
+ * pool areas).  With TM_FAST_INIT it goes to .noinit, which the Cortex-M
+ * startup code does not zero.
+ */
+#ifdef TM_FAST_INIT
+#define TM_NOINIT __attribute__((section(".noinit")))
+#else
+#define TM_NOINIT
+#endif
 
 /* Reporter loop helpers -- centralise the bounded-cycle logic so every
  * test file does not duplicate it.  C89 compatible.  Usage:
  *     TM_REPORT_LOOP {
  *         ... sleep, print, check counters ...
+ *         tm_report_period(total);
  *     } TM_REPORT_FINISH
+ *
+ * tm_report_start() marks the beginning of the first measured interval;
+ * tm_report_period() prints the "Time Period Total" line and closes the
+ * current interval, so per-interval instrumentation lives in one place.
+ * tm_report_counted() is 0 when that interval was discarded for a rerun
+ * (host noise detection), so it does not count towards tm_test_cycles.
  */
 #define TM_REPORT_LOOP                                                     \
     {                                                                      \
         int _tm_cycle;                                                     \
+        tm_report_start();                                                 \
         for (_tm_cycle = 0; !tm_test_cycles || _tm_cycle < tm_test_cycles; \
-             tm_test_cycles ? _tm_cycle++ : 0)
+             tm_test_cycles ? _tm_cycle += tm_report_counted() : 0)
 
 #define TM_REPORT_FINISH \
     }                    \
@@ -101,6 +149,11 @@ int tm_thread_resume(int thread_id);
 int tm_thread_suspend(int thread_id);
 void tm_thread_relinquish(void);
 void tm_thread_sleep(int seconds);
+/* Short critical section around test state that threads share; called
+ * from thread context only, and never nested.
+ */
+void tm_critical_enter(void);
+void tm_critical_exit(void);
 int tm_queue_create(int queue_id);
 int tm_queue_send(int queue_id, unsigned long *message_ptr);
 int tm_queue_receive(int queue_id, unsigned long *message_ptr);
@@ -148,6 +201,70 @@ void tm_cause_interrupt(void);
  */
 void tm_cause_interrupt_sync(void);
 
+/* Periodic hardware interrupt source (Cortex-M targets only; see
+ * ports/common/cortex-m/cmsdk_timer.c).  tm_hw_timer_start() fires
+ * tm_hw_timer_handler() from a real NVIC interrupt at the given rate
+ * until tm_hw_timer_stop().  The handler is supplied by the test and
+ * runs in interrupt context, so it may only call the tm_* services the
+ * interrupt tests already use from their handlers.
+ */
+int tm_hw_timer_start(unsigned long hz);
+void tm_hw_timer_stop(void);
+void tm_hw_timer_handler(void);
+
+/* Interrupt latency support for tm_hw_timer_handler(), in
+ * tm_timestamp_frequency() ticks.  tm_hw_timer_latency() gives the time
+ * from the timer raising the interrupt being handled to the handler's
+ * entry, and returns TM_ERROR when that cannot be measured because the
+ * timer expired again before the interrupt was taken;
+ * tm_hw_timer_set_next_period() sets the length of the period after the
+ * running one, so a test can vary when the interrupt arrives.
+ */
+int tm_hw_timer_latency(unsigned long *ticks);
+void tm_hw_timer_set_next_period(unsigned long ticks);
+
+/* Nested interrupt sources (Cortex-M targets only; see
+ * ports/common/cortex-m/tm_nested_irq.c).  tm_cause_nested_interrupt()
+ * pends the software interrupt of the given level, which runs the
+ * test's tm_nested_interrupt_handler(level).  A TM_NESTED_HIGH interrupt
+ * raised from a TM_NESTED_LOW handler preempts it before the call
+ * returns.  tm_nested_interrupt_depth() counts the nested handlers
+ * currently active.
+ */
+#define TM_NESTED_LOW 0
+#define TM_NESTED_HIGH 1
+
+void tm_cause_nested_interrupt(int level);
+void tm_nested_interrupt_handler(int level);
+int tm_nested_interrupt_depth(void);
+
+/* Nonzero when the RTOS kernel itself considers the caller to be in
+ * interrupt context (ThreadX TX_THREAD_GET_SYSTEM_STATE(), FreeRTOS
+ * xPortIsInsideInterrupt()).  Lets tests check the kernel's interrupt
+ * bookkeeping.
+ */
+int tm_isr_context(void);
+
+/* Free-running timestamp counter for latency measurements.  Counts up
+ * at tm_timestamp_frequency() Hz and wraps modulo ULONG_MAX + 1, so the
+ * unsigned difference of two readings is the elapsed time as long as
+ * it is shorter than one wrap (171 s on Cortex-M, 4.2 s for a 32-bit
+ * host).  Callable from interrupt context.
+ */
+unsigned long tm_timestamp(void);
+unsigned long tm_timestamp_frequency(void);
+
+/* TrustZone secure-side services (Cortex-M33 TrustZone builds only).
+ * tm_secure_context_allocate() gives the calling thread a secure stack,
+ * which the kernel saves and restores on each of the thread's context
+ * switches from then on; a thread calls it before its first
+ * tm_secure_call().  tm_secure_call() enters the secure stub in
+ * ports/common/cortex-m/tz_secure.c through its non-secure-callable
+ * veneer and returns value + 1.
+ */
+int tm_secure_context_allocate(void);
+unsigned long tm_secure_call(unsigned long value);
+
 
 /* Determine if a C++ compiler is being used.  If so, complete the standard
  * C conditional started above.
@@ -3,6 +3,9 @@
 # Reads CONFIG_TARGET_* from .config to select the toolchain and
 # architecture-specific flags.  Provides verbosity control, build
 # directory management, and QEMU semihosting defaults.
+#
+# QEMU_TARGET is non-empty for every target that runs under QEMU
+# (Cortex-M and RISC-V), which share run/check/profile.
 
 MAKEFLAGS += --no-builtin-rules --no-builtin-variables
 
@@ -19,6 +22,8 @@ endif
 # Cross-compilation
 CROSS_COMPILE ?=
 
+QEMU_TARGET := $(CONFIG_TARGET_CORTEX_M_QEMU)$(CONFIG_TARGET_RISCV_QEMU)
+
 ifeq ($(CONFIG_TARGET_CORTEX_M_QEMU),y)
   # Auto-detect ARM cross-compiler when CROSS_COMPILE is not set.
   # Probe PATH first, then well-known installation directories:
@@ -57,6 +62,25 @@ ifeq ($(CONFIG_TARGET_CORTEX_M_QEMU),y)
   endif
 endif
 
+ifeq ($(CONFIG_TARGET_RISCV_QEMU),y)
+  # One riscv64 toolchain builds both RV32 and RV64 through -march and
+  # -mabi.  Fall back to the xPack riscv-none-elf prefix.
+  ifeq ($(CROSS_COMPILE),)
+    ifneq ($(shell which riscv64-unknown-elf-gcc 2>/dev/null),)
+      CROSS_COMPILE := riscv64-unknown-elf-
+    else ifneq ($(shell which riscv-none-elf-gcc 2>/dev/null),)
+      CROSS_COMPILE := riscv-none-elf-
+    else
+      CROSS_COMPILE := riscv64-unknown-elf-
+    endif
+  endif
+
+  QEMU ?=
+  ifeq ($(QEMU),)
+    QEMU := qemu-system-$(if $(CONFIG_RISCV_RV32),riscv32,riscv64)
+  endif
+endif
+
 # Apply CROSS_COMPILE prefix.  Respect explicit user values (CC=clang)
 # via $(origin); check both 'default' and 'undefined' (the latter
 # appears in sub-makes inheriting --no-builtin-variables).
@@ -67,17 +91,17 @@ ifneq ($(filter default undefined,$(origin AR)),)
   AR := $(if $(CROSS_COMPILE),$(CROSS_COMPILE)ar,ar)
 endif
 
-# Validate cross-compiler for Cortex-M build goals.
+# Validate cross-compiler for QEMU target build goals.
 # _NEED_CONFIG and _HAS_CONFGEN are computed in the main Makefile before
 # this file is included.  Skip when a config generator will re-invoke make.
-ifeq ($(CONFIG_TARGET_CORTEX_M_QEMU),y)
+ifneq ($(QEMU_TARGET),)
   ifneq ($(_NEED_CONFIG),)
     ifeq ($(_HAS_CONFGEN),)
     ifeq ($(shell which $(CC) 2>/dev/null),)
       $(info )
       $(info *** Cross-compiler '$(CC)' not found!)
-      $(info *** Install arm-none-eabi-gcc or set CROSS_COMPILE:)
-      $(info ***   make CROSS_COMPILE=/opt/toolchain/arm-none-eabi/bin/arm-none-eabi-)
+      $(info *** Install $(notdir $(CC)) or set CROSS_COMPILE:)
+      $(info ***   make CROSS_COMPILE=$(if $(CONFIG_TARGET_RISCV_QEMU),/opt/toolchain/riscv/bin/riscv64-unknown-elf-,/opt/toolchain/arm-none-eabi/bin/arm-none-eabi-))
       $(info )
       $(error Missing cross-compiler)
     endif
@@ -99,14 +123,65 @@ ifeq ($(CONFIG_DEBUG_SYMBOLS),y)
 endif
 
 ifeq ($(CONFIG_TARGET_CORTEX_M_QEMU),y)
-  CFLAGS_BASE += -mcpu=cortex-m3 -mthumb -mfloat-abi=soft
-  LDFLAGS     += -T ports/common/cortex-m/mps2_an385.ld -nostartfiles
+  # Board: QEMU machine and CPU (exported to scripts/qemu-run.sh) and
+  # the matching code generation.  mps2-an386 shares the mps2-an385
+  # memory map and peripherals, so both use the same linker script.
+  # mps2-an505 links the benchmark into the Secure aliases, or into the
+  # Non-secure half of the memory map when the secure image owns the
+  # rest (CONFIG_CORTEX_M_TRUSTZONE).  MPU builds reserve the
+  # FreeRTOS MPU ports' privileged regions (CONFIG_CORTEX_M_MPU);
+  # RAM-function builds add the .ramfunc section
+  # (CONFIG_CORTEX_M_RAMFUNC).
+  CM_LDSCRIPT_VARIANT := $(if $(CONFIG_CORTEX_M_MPU),_mpu,$(if $(CONFIG_CORTEX_M_RAMFUNC),_ramfunc))
+  ifeq ($(CONFIG_CORTEX_M_AN386),y)
+    QEMU_MACHINE := mps2-an386
+    QEMU_CPU     := cortex-m4
+    CFLAGS_BASE  += -mcpu=cortex-m4 -mthumb -mfloat-abi=hard \
+                    -mfpu=fpv4-sp-d16
+    CM_LDSCRIPT  := ports/common/cortex-m/mps2_an385$(CM_LDSCRIPT_VARIANT).ld
+  else ifeq ($(CONFIG_CORTEX_M_AN505),y)
+    QEMU_MACHINE := mps2-an505
+    QEMU_CPU     := cortex-m33
+    CFLAGS_BASE  += -mcpu=cortex-m33+nofp -mthumb -mfloat-abi=soft
+    CM_LDSCRIPT  := ports/common/cortex-m/mps2_an505$(if $(CONFIG_CORTEX_M_TRUSTZONE),_ns).ld
+  else
+    QEMU_MACHINE := mps2-an385
+    QEMU_CPU     := cortex-m3
+    CFLAGS_BASE  += -mcpu=cortex-m3 -mthumb -mfloat-abi=soft
+    CM_LDSCRIPT  := ports/common/cortex-m/mps2_an385$(CM_LDSCRIPT_VARIANT).ld
+  endif
+  export QEMU_MACHINE QEMU_CPU
+
+  LDFLAGS     += -T $(CM_LDSCRIPT) -nostartfiles
   LDFLAGS     += --specs=rdimon.specs
 
   QEMU_SEMIHOSTING_TARGET ?= native
   QEMU_FLAGS = -semihosting-config enable=on,target=$(QEMU_SEMIHOSTING_TARGET)
 endif
 
+ifeq ($(CONFIG_TARGET_RISCV_QEMU),y)
+  # Machine mode on the virt board: -bios none loads the ELF at
+  # 0x80000000 and starts it directly, without OpenSBI.  medany lets
+  # RV64 code address RAM at 0x80000000.  picolibc supplies the C
+  # library; startup.S replaces its crt0.
+  QEMU_MACHINE := virt
+  ifeq ($(CONFIG_RISCV_RV32),y)
+    QEMU_CPU     := rv32
+    CFLAGS_BASE  += -march=rv32imac_zicsr -mabi=ilp32 -mcmodel=medany
+  else
+    QEMU_CPU     := rv64
+    CFLAGS_BASE  += -march=rv64imac_zicsr -mabi=lp64 -mcmodel=medany
+  endif
+  export QEMU_MACHINE QEMU_CPU
+
+  LDFLAGS     += -T ports/common/riscv/virt.ld -nostartfiles
+  LDFLAGS     += --specs=picolibc.specs
+
+  QEMU_SEMIHOSTING_TARGET ?= native
+  QEMU_FLAGS = -bios none \
+               -semihosting-config enable=on,target=$(QEMU_SEMIHOSTING_TARGET)
+endif
+
 ifeq ($(CONFIG_TARGET_POSIX_HOST),y)
   LDFLAGS += -lpthread
 endif
@@ -0,0 +1,131 @@
+/*
+ * Periodic hardware interrupt source for Thread-Metric on the MPS2 boards.
+ *
+ * TIMER0 of the CMSDK APB timer pair drives tm_hw_timer_start(): a real
+ * NVIC interrupt (IRQ 8, IRQ 3 on mps2-an505) arriving asynchronously to
+ * the running thread, unlike the software-triggered SVC / IRQ 31 paths
+ * behind tm_cause_interrupt().  Its handler overrides the weak alias in
+ * vector_table.c, acknowledges the timer and calls the test's
+ * tm_hw_timer_handler().  RTOS-neutral: the handler uses tm_* APIs,
+ * which detect interrupt context on their own.
+ *
+ * TIMER1 free-runs without an interrupt as the tm_timestamp() source.
+ */
+
+#include "cmsdk_timer.h"
+#include "tm_api.h"
+#include "tm_nvic.h"
+
+/* Default for tests that do not use the hardware timer. */
+__attribute__((weak)) void tm_hw_timer_handler(void) {}
+
+/* RELOAD as last programmed, and the value the counter was reloaded
+ * with when the current interrupt was raised.  RELOAD only changes
+ * from the handler, so the two differ only after a
+ * tm_hw_timer_set_next_period() call.
+ */
+static unsigned long tm_hw_timer_reload;
+static unsigned long tm_hw_timer_loaded;
+
+/* Latency of the interrupt being handled, taken on entry, and the
+ * tm_timestamp() time of the expiry that raised it.
+ */
+static unsigned long tm_hw_timer_sample;
+static int tm_hw_timer_sample_valid;
+static unsigned long tm_hw_timer_expiry;
+
+/* The counter reloaded when it raised the interrupt and has counted
+ * down since, so the distance from the reload value is the time the
+ * interrupt has been pending plus the entry cost.  That only holds if
+ * it has not reloaded again before the handler ran: a value above the
+ * reload value, or an expiry that is not one period after the previous
+ * one on TIMER1, means a period went by unhandled.  A missed period
+ * moves the expiry by at least the shorter of the two periods, so half
+ * of that separates it from the few ticks between the two reads.
+ */
+void CMSDK_TIMER0_HANDLER(void)
+{
+    unsigned long value = CMSDK_TIMER0->value;
+    unsigned long now = tm_timestamp();
+    unsigned long expected = tm_hw_timer_expiry + tm_hw_timer_loaded + 1;
+    unsigned long tolerance = tm_hw_timer_loaded;
+    long drift;
+
+    tm_hw_timer_loaded = tm_hw_timer_reload;
+    if (tolerance > tm_hw_timer_loaded)
+        tolerance = tm_hw_timer_loaded;
+    tolerance = (tolerance + 1) / 2;
+
+    tm_hw_timer_sample = tm_hw_timer_loaded - value;
+    tm_hw_timer_expiry = now - tm_hw_timer_sample;
+    drift = (long) (tm_hw_timer_expiry - expected);
+    tm_hw_timer_sample_valid = value <= tm_hw_timer_loaded &&
+                               drift < (long) tolerance &&
+                               -drift < (long) tolerance;
+
+    CMSDK_TIMER0->intclr = 1;
+    tm_hw_timer_handler();
+}
+
+int tm_hw_timer_start(unsigned long hz)
+{
+    if (hz == 0 || hz > CMSDK_TIMER_CLOCK_HZ)
+        return TM_ERROR;
+
+    CMSDK_TIMER0->ctrl = 0;
+    tm_hw_timer_reload = CMSDK_TIMER_CLOCK_HZ / hz - 1;
+    tm_hw_timer_loaded = tm_hw_timer_reload;
+    CMSDK_TIMER0->reload = tm_hw_timer_reload;
+    CMSDK_TIMER0->value = tm_hw_timer_reload;
+    CMSDK_TIMER0->intclr = 1;
+
+    tm_nvic_clear_pending(CMSDK_TIMER0_IRQ);
+    tm_nvic_set_priority(CMSDK_TIMER0_IRQ, TM_NVIC_PRIORITY_TIMER);
+    tm_nvic_enable(CMSDK_TIMER0_IRQ);
+
+    /* The first expiry is one period from here. */
+    tm_hw_timer_expiry = tm_timestamp();
+    CMSDK_TIMER0->ctrl = CMSDK_TIMER_CTRL_EN | CMSDK_TIMER_CTRL_IRQEN;
+    return TM_SUCCESS;
+}
+
+void tm_hw_timer_stop(void)
+{
+    CMSDK_TIMER0->ctrl = 0;
+    tm_nvic_disable(CMSDK_TIMER0_IRQ);
+    CMSDK_TIMER0->intclr = 1;
+    tm_nvic_clear_pending(CMSDK_TIMER0_IRQ);
+}
+
+int tm_hw_timer_latency(unsigned long *ticks)
+{
+    *ticks = tm_hw_timer_sample;
+    return tm_hw_timer_sample_valid ? TM_SUCCESS : TM_ERROR;
+}
+
+/* Takes effect when the running period expires. */
+void tm_hw_timer_set_next_period(unsigned long ticks)
+{
+    if (ticks < 2)
+        ticks = 2;
+    tm_hw_timer_reload = ticks - 1;
+    CMSDK_TIMER0->reload = tm_hw_timer_reload;
+}
+
+/* TIMER1 counts down from 0xFFFFFFFF; invert it to count up.  Started
+ * on first use so tests that never take a timestamp leave it idle.
+ */
+unsigned long tm_timestamp(void)
+{
+    if (!(CMSDK_TIMER1->ctrl & CMSDK_TIMER_CTRL_EN)) {
+        CMSDK_TIMER1->reload = 0xFFFFFFFFUL;
+        CMSDK_TIMER1->value = 0xFFFFFFFFUL;
+        CMSDK_TIMER1->ctrl = CMSDK_TIMER_CTRL_EN;
+    }
+    return ~CMSDK_TIMER1->value;
+}
+
+unsigned long tm_timestamp_frequency(void)
+{
+    return CMSDK_TIMER_CLOCK_HZ;
+}
@@ -0,0 +1,48 @@
+/*
+ * ARM CMSDK APB timer, as found on the MPS2 boards.
+ *
+ * mps2-an385 has two instances clocked from the 25 MHz system clock:
+ * TIMER0 at 0x40000000 (IRQ 8) and TIMER1 at 0x40001000 (IRQ 9).  The
+ * counter decrements from RELOAD to 0, raises its interrupt and reloads.
+ *
+ * mps2-an505 (TM_MPS2_AN505) has the same pair inside the IoTKit, at
+ * IRQs 3 and 4 and clocked at 20 MHz.  The Secure alias (base
+ * 0x50000000) is used unless the benchmark runs Non-secure
+ * (TM_TRUSTZONE), after the secure image has opened the timers' PPC.
+ */
+
+#ifndef CMSDK_TIMER_H
+#define CMSDK_TIMER_H
+
+typedef struct {
+    volatile unsigned long ctrl;   /* 0x00: control */
+    volatile unsigned long value;  /* 0x04: current count */
+    volatile unsigned long reload; /* 0x08: reload value */
+    volatile unsigned long intclr; /* 0x0C: read status, write 1 to clear */
+} cmsdk_timer_t;
+
+#if defined(TM_MPS2_AN505) && !defined(TM_TRUSTZONE)
+#define CMSDK_APB_BASE 0x50000000UL
+#else
+#define CMSDK_APB_BASE 0x40000000UL
+#endif
+
+#define CMSDK_TIMER0 ((cmsdk_timer_t *) (CMSDK_APB_BASE + 0x0000UL))
+#define CMSDK_TIMER1 ((cmsdk_timer_t *) (CMSDK_APB_BASE + 0x1000UL))
+
+#ifdef TM_MPS2_AN505
+#define CMSDK_TIMER0_IRQ 3
+#define CMSDK_TIMER1_IRQ 4
+#define CMSDK_TIMER0_HANDLER IRQ3_Handler
+#define CMSDK_TIMER_CLOCK_HZ 20000000UL
+#else
+#define CMSDK_TIMER0_IRQ 8
+#define CMSDK_TIMER1_IRQ 9
+#define CMSDK_TIMER0_HANDLER IRQ8_Handler
+#define CMSDK_TIMER_CLOCK_HZ 25000000UL
+#endif
+
+#define CMSDK_TIMER_CTRL_EN (1UL << 0)
+#define CMSDK_TIMER_CTRL_IRQEN (1UL << 3)
+
+#endif /* CMSDK_TIMER_H */
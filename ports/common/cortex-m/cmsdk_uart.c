@@ -0,0 +1,151 @@
+/*
+ * Interrupt-driven console on CMSDK UART0 (TM_UART_CONSOLE builds).
+ *
+ * Replaces the semihosting tm_putchar() in tm_putchar.c, which traps
+ * into the host debugger once per character.  Here tm_putchar() only
+ * appends to a ring buffer; the UART transmit interrupt takes the next
+ * character each time the previous one has gone out, so the reporter
+ * thread hands its text off in microseconds.  The run still ends
+ * through the semihosting exit, which flushes the ring first.
+ *
+ * One producer (the reporter, or a fatal-error path) and one consumer
+ * (the interrupt).  Whenever the consumer cannot run -- the ring is
+ * full, interrupts are masked by PRIMASK or BASEPRI, or the caller is an
+ * exception handler -- tm_putchar() drains by polling instead, so a
+ * fault report is never lost.  RTOS-neutral: the handler calls no
+ * kernel service.
+ */
+
+#include "cmsdk_uart.h"
+#include "tm_api.h"
+#include "tm_nvic.h"
+
+#define TM_UART_BAUD 115200UL
+
+/* Power of two, so the free-running indices wrap cleanly. */
+#ifndef TM_UART_TX_BUFFER
+#define TM_UART_TX_BUFFER 1024UL
+#endif
+
+/* Below the benchmark interrupt sources, above PendSV. */
+#define TM_NVIC_PRIORITY_UART 0xE0
+
+static char tm_uart_buffer[TM_UART_TX_BUFFER];
+static volatile unsigned long tm_uart_head; /* next slot to fill */
+static volatile unsigned long tm_uart_tail; /* next slot to send */
+static volatile int tm_uart_busy;           /* a character is in flight */
+static int tm_uart_ready;
+
+static unsigned long tm_uart_irq_save(void)
+{
+    unsigned long primask;
+
+    __asm volatile("mrs %0, primask\n\tcpsid i" : "=r"(primask)::"memory");
+    return primask;
+}
+
+static void tm_uart_irq_restore(unsigned long primask)
+{
+    __asm volatile("msr primask, %0" ::"r"(primask) : "memory");
+}
+
+static void tm_uart_init(void)
+{
+    CMSDK_UART0->ctrl = 0;
+    CMSDK_UART0->bauddiv = CMSDK_UART_CLOCK_HZ / TM_UART_BAUD;
+    CMSDK_UART0->intstat = CMSDK_UART_INT_TX;
+
+    tm_nvic_clear_pending(CMSDK_UART0_TX_IRQ);
+    tm_nvic_set_priority(CMSDK_UART0_TX_IRQ, TM_NVIC_PRIORITY_UART);
+    tm_nvic_enable(CMSDK_UART0_TX_IRQ);
+
+    CMSDK_UART0->ctrl = CMSDK_UART_CTRL_TXEN | CMSDK_UART_CTRL_TXINTEN;
+    tm_uart_ready = 1;
+}
+
+/* Start the next character, if any.  Interrupts masked. */
+static void tm_uart_send_next(void)
+{
+    if (tm_uart_tail == tm_uart_head) {
+        tm_uart_busy = 0;
+        return;
+    }
+    if (CMSDK_UART0->state & CMSDK_UART_STATE_TXFULL)
+        return;
+    CMSDK_UART0->data =
+        (unsigned char) tm_uart_buffer[tm_uart_tail & (TM_UART_TX_BUFFER - 1)];
+    tm_uart_tail = tm_uart_tail + 1;
+    tm_uart_busy = 1;
+}
+
+void CMSDK_UART0_TX_HANDLER(void)
+{
+    CMSDK_UART0->intstat = CMSDK_UART_INT_TX;
+    tm_uart_send_next();
+}
+
+/* 1 if the transmit interrupt cannot be taken now: interrupts masked by
+ * PRIMASK, or by BASEPRI at or above the UART's priority, or the caller
+ * is an exception handler (HardFault, MemManage, a benchmark ISR) that
+ * the UART cannot preempt.
+ */
+static int tm_uart_irq_blocked(void)
+{
+    unsigned long primask, basepri, ipsr;
+
+    __asm volatile("mrs %0, primask" : "=r"(primask));
+    __asm volatile("mrs %0, basepri" : "=r"(basepri));
+    __asm volatile("mrs %0, ipsr" : "=r"(ipsr));
+    return (primask & 1) ||
+           (basepri != 0 && basepri <= TM_NVIC_PRIORITY_UART) ||
+           (ipsr & 0x1FF) != 0;
+}
+
+/* Move one character without the interrupt's help. */
+static void tm_uart_poll(void)
+{
+    unsigned long primask = tm_uart_irq_save();
+
+    if (!(CMSDK_UART0->state & CMSDK_UART_STATE_TXFULL)) {
+        CMSDK_UART0->intstat = CMSDK_UART_INT_TX;
+        tm_uart_send_next();
+    }
+    tm_uart_irq_restore(primask);
+}
+
+void tm_putchar(int c)
+{
+    unsigned long primask;
+
+    if (!tm_uart_ready)
+        tm_uart_init();
+
+    while (tm_uart_head - tm_uart_tail >= TM_UART_TX_BUFFER)
+        tm_uart_poll();
+
+    tm_uart_buffer[tm_uart_head & (TM_UART_TX_BUFFER - 1)] = (char) c;
+
+    primask = tm_uart_irq_save();
+    tm_uart_head = tm_uart_head + 1;
+    if (!tm_uart_busy)
+        tm_uart_send_next();
+    tm_uart_irq_restore(primask);
+
+    /* Nothing would drain the ring until the caller returns, which a
+     * fatal-error path never does.
+     */
+    if (tm_uart_irq_blocked()) {
+        while (tm_uart_tail != tm_uart_head)
+            tm_uart_poll();
+    }
+}
+
+void tm_uart_flush(void)
+{
+    if (!tm_uart_ready)
+        return;
+    while (tm_uart_tail != tm_uart_head)
+        tm_uart_poll();
+    while (CMSDK_UART0->state & CMSDK_UART_STATE_TXFULL)
+        ;
+}
@@ -0,0 +1,36 @@
+/*
+ * ARM CMSDK APB UART, as found on the MPS2 boards.
+ *
+ * mps2-an385 / mps2-an386 put UART0 at 0x40004000, with its receive
+ * interrupt on IRQ 0 and its transmit interrupt on IRQ 1, clocked from
+ * the 25 MHz system clock.  The transmit interrupt is raised each time a
+ * character written to DATA has left the transmitter.
+ */
+
+#ifndef CMSDK_UART_H
+#define CMSDK_UART_H
+
+typedef struct {
+    volatile unsigned long data;    /* 0x00: transmit / receive data */
+    volatile unsigned long state;   /* 0x04: buffer full / overrun flags */
+    volatile unsigned long ctrl;    /* 0x08: enables */
+    volatile unsigned long intstat; /* 0x0C: read status, write 1 to clear */
+    volatile unsigned long bauddiv; /* 0x10: clock divider, at least 16 */
+} cmsdk_uart_t;
+
+#define CMSDK_UART0 ((cmsdk_uart_t *) 0x40004000UL)
+#define CMSDK_UART0_TX_IRQ 1
+#define CMSDK_UART0_TX_HANDLER IRQ1_Handler
+#define CMSDK_UART_CLOCK_HZ 25000000UL
+
+#define CMSDK_UART_STATE_TXFULL (1UL << 0)
+#define CMSDK_UART_CTRL_TXEN (1UL << 0)
+#define CMSDK_UART_CTRL_TXINTEN (1UL << 2)
+#define CMSDK_UART_INT_TX (1UL << 0)
+
+/* Wait until every buffered character has been written to the UART.
+ * Called before the semihosting exit ends the run.
+ */
+void tm_uart_flush(void);
+
+#endif /* CMSDK_UART_H */
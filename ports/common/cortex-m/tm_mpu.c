@@ -0,0 +1,21 @@
+/*
+ * MPU fault reporting for TM_MPU builds on the MPS2 boards.
+ *
+ * RTOS-neutral -- shared by the ThreadX and FreeRTOS MPU configurations.
+ * Overrides the weak MemManage_Handler alias in vector_table.c, so a
+ * thread that runs into its stack guard (or any other MPU violation)
+ * ends the run with a diagnostic instead of hanging in Default_Handler.
+ * Each port enables the MPU and SHCSR.MEMFAULTENA itself.
+ */
+
+#include "tm_api.h"
+#include "tm_mpu.h"
+
+void MemManage_Handler(void)
+{
+    if (TM_SCB_CFSR & TM_SCB_CFSR_MMARVALID)
+        tm_printf("FATAL: MPU fault, address 0x%lx\n", TM_SCB_MMFAR);
+    else
+        tm_printf("FATAL: MPU fault, address unknown\n");
+    tm_check_fail("FATAL: thread stack overflow or MPU violation\n");
+}
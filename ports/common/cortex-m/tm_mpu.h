@@ -0,0 +1,47 @@
+/*
+ * Minimal PMSAv7 MPU access for the Cortex-M3/M4F ports (TM_MPU builds).
+ *
+ * Only what the Thread-Metric stack regions need; no CMSIS dependency.
+ * Region sizes are powers of two and bases are aligned to the size.
+ * A higher region number wins where regions overlap.
+ */
+
+#ifndef TM_MPU_H
+#define TM_MPU_H
+
+#define TM_MPU_TYPE (*(volatile unsigned long *) 0xE000ED90UL)
+#define TM_MPU_CTRL (*(volatile unsigned long *) 0xE000ED94UL)
+#define TM_MPU_RNR (*(volatile unsigned long *) 0xE000ED98UL)
+#define TM_MPU_RBAR (*(volatile unsigned long *) 0xE000ED9CUL)
+#define TM_MPU_RASR (*(volatile unsigned long *) 0xE000EDA0UL)
+
+#define TM_MPU_CTRL_ENABLE (1UL << 0)
+#define TM_MPU_CTRL_PRIVDEFENA (1UL << 2)
+
+#define TM_MPU_RBAR_VALID (1UL << 4)
+
+#define TM_MPU_RASR_ENABLE (1UL << 0)
+#define TM_MPU_RASR_SIZE(log2) ((unsigned long) ((log2) - 1) << 1)
+#define TM_MPU_RASR_NORMAL_WB ((1UL << 17) | (1UL << 16)) /* C, B */
+#define TM_MPU_RASR_AP_RW (3UL << 24)
+#define TM_MPU_RASR_AP_NONE (0UL << 24)
+#define TM_MPU_RASR_XN (1UL << 28)
+
+/* SHCSR.MEMFAULTENA: take MPU faults as MemManage, not HardFault. */
+#define TM_SCB_SHCSR (*(volatile unsigned long *) 0xE000ED24UL)
+#define TM_SCB_SHCSR_MEMFAULTENA (1UL << 16)
+#define TM_SCB_MMFAR (*(volatile unsigned long *) 0xE000ED34UL)
+
+/* CFSR.MMARVALID: MMFAR holds the faulting data address.  Clear for
+ * instruction-access and exception stacking faults.
+ */
+#define TM_SCB_CFSR (*(volatile unsigned long *) 0xE000ED28UL)
+#define TM_SCB_CFSR_MMARVALID (1UL << 7)
+
+/* No-access guard at the bottom of every thread stack.  32 bytes is
+ * the smallest PMSAv7 region.
+ */
+#define TM_MPU_GUARD_LOG2 5
+#define TM_MPU_GUARD_SIZE (1UL << TM_MPU_GUARD_LOG2)
+
+#endif /* TM_MPU_H */
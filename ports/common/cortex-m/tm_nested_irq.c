@@ -0,0 +1,72 @@
+/*
+ * Nested software interrupt sources for Thread-Metric on the MPS2 boards.
+ *
+ * Two external IRQs pended through NVIC_ISPR at different priorities,
+ * so a TM_NESTED_HIGH interrupt raised from a running TM_NESTED_LOW
+ * handler preempts it immediately.  Their handlers override the weak
+ * aliases in vector_table.c and call the test's
+ * tm_nested_interrupt_handler().  RTOS-neutral: both priorities are
+ * numerically at or above FreeRTOS configMAX_SYSCALL_INTERRUPT_PRIORITY,
+ * so either handler may call FromISR APIs, and ThreadX masks with
+ * PRIMASK only, so any level suits it.  The tm_* APIs detect interrupt
+ * context on their own.
+ */
+
+#include <stdbool.h>
+#include "tm_api.h"
+#include "tm_nvic.h"
+
+#define TM_NESTED_LOW_IRQ 30
+#define TM_NESTED_HIGH_IRQ 29
+
+/* Default for tests that do not use the nested sources. */
+__attribute__((weak)) void tm_nested_interrupt_handler(int level)
+{
+    (void) level;
+}
+
+static volatile int tm_nested_depth;
+
+void IRQ30_Handler(void)
+{
+    tm_nested_depth++;
+    tm_nested_interrupt_handler(TM_NESTED_LOW);
+    tm_nested_depth--;
+}
+
+void IRQ29_Handler(void)
+{
+    tm_nested_depth++;
+    tm_nested_interrupt_handler(TM_NESTED_HIGH);
+    tm_nested_depth--;
+}
+
+/* Set up on first use, from thread context. */
+static void tm_nested_irq_init(void)
+{
+    static bool initialized;
+
+    if (initialized)
+        return;
+    initialized = true;
+    tm_nvic_set_priority(TM_NESTED_LOW_IRQ, TM_NVIC_PRIORITY_NESTED_LOW);
+    tm_nvic_set_priority(TM_NESTED_HIGH_IRQ, TM_NVIC_PRIORITY_NESTED_HIGH);
+    tm_nvic_enable(TM_NESTED_LOW_IRQ);
+    tm_nvic_enable(TM_NESTED_HIGH_IRQ);
+}
+
+/* The barriers make the pend take effect before the caller continues:
+ * a higher-priority interrupt is entered before this returns.
+ */
+void tm_cause_nested_interrupt(int level)
+{
+    tm_nested_irq_init();
+    tm_nvic_set_pending(level == TM_NESTED_HIGH ? TM_NESTED_HIGH_IRQ
+                                                : TM_NESTED_LOW_IRQ);
+    __asm volatile("dsb\n\tisb" ::: "memory");
+}
+
+int tm_nested_interrupt_depth(void)
+{
+    return tm_nested_depth;
+}
@@ -0,0 +1,56 @@
+/*
+ * Minimal NVIC access for the Cortex-M ports.
+ *
+ * Only what the Thread-Metric drivers need; no CMSIS dependency.  IRQ
+ * numbers are external interrupt numbers (0 = first entry after
+ * SysTick in the vector table).
+ */
+
+#ifndef TM_NVIC_H
+#define TM_NVIC_H
+
+#define TM_NVIC_ISER ((volatile unsigned long *) 0xE000E100UL)
+#define TM_NVIC_ICER ((volatile unsigned long *) 0xE000E180UL)
+#define TM_NVIC_ISPR ((volatile unsigned long *) 0xE000E200UL)
+#define TM_NVIC_ICPR ((volatile unsigned long *) 0xE000E280UL)
+#define TM_NVIC_IPR ((volatile unsigned char *) 0xE000E400UL)
+
+/* Priority of benchmark hardware interrupt sources.  Numerically above
+ * FreeRTOS configMAX_SYSCALL_INTERRUPT_PRIORITY (0xA0), so handlers may
+ * call FromISR APIs, and below PendSV (lowest), so a context switch
+ * requested by a handler is taken when it returns.
+ */
+#define TM_NVIC_PRIORITY_TIMER 0xC0
+
+/* Priorities of the nested software interrupt sources: the lowest and
+ * highest levels that may still call FreeRTOS FromISR APIs.
+ */
+#define TM_NVIC_PRIORITY_NESTED_LOW 0xC0
+#define TM_NVIC_PRIORITY_NESTED_HIGH 0xA0
+
+static inline void tm_nvic_enable(int irq)
+{
+    TM_NVIC_ISER[irq >> 5] = 1UL << (irq & 31);
+}
+
+static inline void tm_nvic_disable(int irq)
+{
+    TM_NVIC_ICER[irq >> 5] = 1UL << (irq & 31);
+}
+
+static inline void tm_nvic_set_pending(int irq)
+{
+    TM_NVIC_ISPR[irq >> 5] = 1UL << (irq & 31);
+}
+
+static inline void tm_nvic_clear_pending(int irq)
+{
+    TM_NVIC_ICPR[irq >> 5] = 1UL << (irq & 31);
+}
+
+static inline void tm_nvic_set_priority(int irq, unsigned char priority)
+{
+    TM_NVIC_IPR[irq] = priority;
+}
+
+#endif /* TM_NVIC_H */
@@ -4,6 +4,10 @@
  * RTOS-neutral -- shared by all Cortex-M porting layers.
  * Compiled only when TM_SEMIHOSTING is defined.
  *
+ * tm_putchar() here is the default console; TM_UART_CONSOLE builds
+ * replace it with the interrupt-driven UART in cmsdk_uart.c and keep
+ * only the exit.
+ *
  * These bypass newlib entirely.  In particular, tm_semihosting_exit()
  * avoids the deep call chain in newlib's _exit() which probes for
  * SYS_EXIT_EXTENDED support by opening ":semihosting-features",
@@ -15,7 +19,12 @@
  */
 
 #include "tm_api.h"
+#ifdef TM_UART_CONSOLE
+#include "cmsdk_uart.h"
+#endif
 
+/* TM_UART_CONSOLE builds print through cmsdk_uart.c instead. */
+#ifndef TM_UART_CONSOLE
 void tm_putchar(int c)
 {
     /* ARM semihosting SYS_WRITEC (0x03). */
@@ -24,6 +33,7 @@ void tm_putchar(int c)
     register char *r1 __asm__("r1") = &ch;
     __asm__ volatile("bkpt #0xAB" : : "r"(r0), "r"(r1) : "memory");
 }
+#endif
 
 void tm_semihosting_exit(int code)
 {
@@ -31,8 +41,14 @@ void tm_semihosting_exit(int code)
      * On M-profile, r1 is the reason code directly (not a pointer).
      * ADP_Stopped_ApplicationExit = 0x20026.
      */
-    register int r0 __asm__("r0") = 0x18;
-    register int r1 __asm__("r1") = code == 0 ? 0x20026 : 0x20024;
+    register int r0 __asm__("r0");
+    register int r1 __asm__("r1");
+
+#ifdef TM_UART_CONSOLE
+    tm_uart_flush();
+#endif
+    r0 = 0x18;
+    r1 = code == 0 ? 0x20026 : 0x20024;
     __asm__ volatile("bkpt #0xAB" : : "r"(r0), "r"(r1) : "memory");
     for (;;)
         ;
@@ -0,0 +1,133 @@
+/*
+ * Secure image for TrustZone builds on QEMU mps2-an505 (Cortex-M33).
+ *
+ * Linked on its own (mps2_an505.ld, -mcmse) together with the kernel's
+ * secure context manager, and loaded next to the Non-secure benchmark.
+ * The core resets into the Secure state, runs startup.S and this
+ * main(), which:
+ *
+ *   1. Marks the upper half of SSRAM1 (Non-secure code) and all of
+ *      SSRAM3 (Non-secure data) Non-secure in their memory protection
+ *      controllers.  SSRAM2 stays Secure for this image.
+ *   2. Opens the CMSDK TIMER0/TIMER1 peripheral protection controller
+ *      to Non-secure accesses.
+ *   3. Programs the SAU: the Non-secure code, data and peripheral
+ *      windows, plus the .gnu.sgstubs veneers as non-secure-callable.
+ *      The IoTKit IDAU only grants NSC where NSCCFG allows it, so the
+ *      Secure code region is flagged there too.
+ *   4. Targets every external interrupt at the Non-secure world.
+ *   5. Points VTOR_NS and MSP_NS at the Non-secure vector table and
+ *      branches to its reset handler with BLXNS.
+ *
+ * The Non-secure side links against the import library generated from
+ * this image (--out-implib), so its calls land on the SG veneers of the
+ * cmse_nonsecure_entry functions below and of the kernel's secure
+ * context manager.
+ */
+
+#include <arm_cmse.h>
+
+/* Non-secure vector table: FLASH base in mps2_an505_ns.ld. */
+#define TM_TZ_NS_VECTORS 0x00200000UL
+
+/* Memory protection controllers of the three ZBT SSRAMs. */
+#define TM_TZ_MPC_SSRAM1 0x58007000UL
+#define TM_TZ_MPC_SSRAM3 0x58009000UL
+#define TM_TZ_SSRAM_HALF 0x00200000UL
+
+/* MPC registers, as word indexes. */
+#define TM_MPC_CTRL 0
+#define TM_MPC_BLK_CFG 5
+#define TM_MPC_BLK_IDX 6
+#define TM_MPC_BLK_LUT 7
+#define TM_MPC_CTRL_AUTOINC (1UL << 8)
+
+/* Secure privilege control block. */
+#define TM_TZ_SPC_NSCCFG (*(volatile unsigned long *) 0x50080014UL)
+#define TM_TZ_SPC_APBNSPPC0 (*(volatile unsigned long *) 0x50080070UL)
+#define TM_TZ_NSCCFG_CODENSC (1UL << 0)
+#define TM_TZ_PPC_TIMER0 (1UL << 0)
+#define TM_TZ_PPC_TIMER1 (1UL << 1)
+
+/* SAU and NVIC interrupt target registers. */
+#define TM_SAU_CTRL (*(volatile unsigned long *) 0xE000EDD0UL)
+#define TM_SAU_RNR (*(volatile unsigned long *) 0xE000EDD8UL)
+#define TM_SAU_RBAR (*(volatile unsigned long *) 0xE000EDDCUL)
+#define TM_SAU_RLAR (*(volatile unsigned long *) 0xE000EDE0UL)
+#define TM_SAU_RLAR_ENABLE (1UL << 0)
+#define TM_SAU_RLAR_NSC (1UL << 1)
+#define TM_NVIC_ITNS ((volatile unsigned long *) 0xE000E380UL)
+#define TM_SCB_NS_VTOR (*(volatile unsigned long *) 0xE002ED08UL)
+
+typedef void __attribute__((cmse_nonsecure_call)) tm_tz_ns_entry_t(void);
+
+extern char __sg_start[];
+extern char __sg_end[];
+
+/* Stub the Thread-Metric Secure Context Scheduling test calls on every
+ * thread activation: just enough work to check the round trip.
+ */
+unsigned long __attribute__((cmse_nonsecure_entry))
+tm_secure_call(unsigned long value)
+{
+    return value + 1;
+}
+
+/* Mark [offset, offset + size) of the memory behind an MPC Non-secure.
+ * The block size comes from BLK_CFG; each LUT word covers 32 blocks.
+ */
+static void tm_tz_mpc_set_ns(unsigned long mpc, unsigned long offset,
+                             unsigned long size)
+{
+    volatile unsigned long *regs = (volatile unsigned long *) mpc;
+    unsigned long block = 1UL << (regs[TM_MPC_BLK_CFG] + 5);
+    unsigned long i;
+
+    regs[TM_MPC_CTRL] &= ~TM_MPC_CTRL_AUTOINC;
+    for (i = offset / block; i < (offset + size) / block; i++) {
+        regs[TM_MPC_BLK_IDX] = i / 32;
+        regs[TM_MPC_BLK_LUT] |= 1UL << (i % 32);
+    }
+}
+
+static void tm_tz_sau_region(int n, unsigned long base, unsigned long limit,
+                             unsigned long flags)
+{
+    TM_SAU_RNR = n;
+    TM_SAU_RBAR = base & ~31UL;
+    TM_SAU_RLAR = (limit & ~31UL) | flags | TM_SAU_RLAR_ENABLE;
+}
+
+int main(void)
+{
+    const unsigned long *ns_vectors = (const unsigned long *) TM_TZ_NS_VECTORS;
+    tm_tz_ns_entry_t *ns_reset;
+    int i;
+
+    tm_tz_mpc_set_ns(TM_TZ_MPC_SSRAM1, TM_TZ_SSRAM_HALF, TM_TZ_SSRAM_HALF);
+    tm_tz_mpc_set_ns(TM_TZ_MPC_SSRAM3, 0, TM_TZ_SSRAM_HALF);
+
+    TM_TZ_SPC_APBNSPPC0 |= TM_TZ_PPC_TIMER0 | TM_TZ_PPC_TIMER1;
+    TM_TZ_SPC_NSCCFG |= TM_TZ_NSCCFG_CODENSC;
+
+    tm_tz_sau_region(0, 0x00200000UL, 0x003FFFFFUL, 0);
+    tm_tz_sau_region(1, 0x28200000UL, 0x283FFFFFUL, 0);
+    tm_tz_sau_region(2, 0x40000000UL, 0x4FFFFFFFUL, 0);
+    tm_tz_sau_region(3, (unsigned long) __sg_start,
+                     (unsigned long) __sg_end - 1, TM_SAU_RLAR_NSC);
+    TM_SAU_CTRL = 1;
+
+    /* Writes past the implemented interrupts are ignored. */
+    for (i = 0; i < 16; i++)
+        TM_NVIC_ITNS[i] = 0xFFFFFFFFUL;
+
+    __asm volatile("dsb\n\tisb" ::: "memory");
+
+    TM_SCB_NS_VTOR = TM_TZ_NS_VECTORS;
+    __asm volatile("msr msp_ns, %0" : : "r"(ns_vectors[0]));
+    ns_reset = (tm_tz_ns_entry_t *) ns_vectors[1];
+    ns_reset();
+
+    for (;;)
+        ;
+}
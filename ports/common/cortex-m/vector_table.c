@@ -1,5 +1,8 @@
 /*
- * Default Cortex-M3 vector table for QEMU mps2-an385.
+ * Default Cortex-M vector table for QEMU mps2-an385 / mps2-an386 (the
+ * two boards share their interrupt map) and mps2-an505.  TrustZone
+ * builds link one copy into the secure image and one into the
+ * Non-secure benchmark.
  *
  * All exception handlers are weak aliases to Default_Handler (infinite
  * loop).  Each RTOS overrides the handlers it owns:
@@ -31,7 +34,10 @@ void SysTick_Handler(void) __attribute__((weak, alias("Default_Handler")));
 
 /* External interrupt handlers (IRQ 0-31).  Weak aliases allow any RTOS
  * port or application code to override individual handlers.  FreeRTOS
- * Cortex-M port uses IRQ 31 for software-triggered interrupt dispatch.
+ * Cortex-M port uses IRQ 31 for software-triggered interrupt dispatch
+ * (so does ThreadX on mps2-an505).  IRQ 8 (IRQ 3 on mps2-an505) is
+ * CMSDK TIMER0, owned by cmsdk_timer.c.  IRQs 29 and 30 are the nested
+ * interrupt sources, owned by tm_nested_irq.c.
  */
 void IRQ0_Handler(void) __attribute__((weak, alias("Default_Handler")));
 void IRQ1_Handler(void) __attribute__((weak, alias("Default_Handler")));
@@ -0,0 +1,122 @@
+/*
+ * Per-interval hardware counters for POSIX host builds (Linux).
+ *
+ * Operations per second says which kernel is faster, not why.  With
+ * TM_HOST_COUNTERS each reporting interval also prints IPC and the
+ * cost of one benchmark operation (one counter increment of the running
+ * test -- e.g. one tm_queue_send/tm_queue_receive pair for Message
+ * Processing) in instructions, cycles, branch misses and cache misses,
+ * plus the number of host context switches in the interval.
+ *
+ * Counters are opened individually rather than as a group: grouped
+ * counters cannot be combined with inherit on older kernels, and the
+ * simulator's threads are all created after main() opens them.
+ */
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#endif
+#include "tm_api.h"
+#include "tm_host.h"
+
+enum {
+    TM_CNT_CYCLES,
+    TM_CNT_INSTRUCTIONS,
+    TM_CNT_BRANCH_MISSES,
+    TM_CNT_CACHE_MISSES,
+    TM_CNT_CONTEXT_SWITCHES,
+    TM_CNT_NUM
+};
+
+static int tm_counters_fd[TM_CNT_NUM] = {-1, -1, -1, -1, -1};
+static unsigned long long tm_counters_last[TM_CNT_NUM];
+
+void tm_counters_init(void)
+{
+    int i, opened = 0;
+
+#ifdef __linux__
+    tm_counters_fd[TM_CNT_CYCLES] =
+        tm_perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    tm_counters_fd[TM_CNT_INSTRUCTIONS] =
+        tm_perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    tm_counters_fd[TM_CNT_BRANCH_MISSES] =
+        tm_perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    tm_counters_fd[TM_CNT_CACHE_MISSES] =
+        tm_perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    tm_counters_fd[TM_CNT_CONTEXT_SWITCHES] =
+        tm_perf_open(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES);
+#endif
+
+    for (i = 0; i < TM_CNT_NUM; i++)
+        if (tm_counters_fd[i] >= 0)
+            opened++;
+    if (opened < TM_CNT_NUM)
+        tm_printf("Thread-Metric: %d of %d perf counters available\n",
+                  opened, TM_CNT_NUM);
+}
+
+static void tm_counters_read(unsigned long long *value)
+{
+    int i;
+
+    for (i = 0; i < TM_CNT_NUM; i++) {
+        value[i] = 0;
+        tm_perf_read(tm_counters_fd[i], &value[i]);
+    }
+}
+
+void tm_counters_start(void)
+{
+    tm_counters_read(tm_counters_last);
+}
+
+/* Print num / den with two decimals, or "n/a" if the counter is closed. */
+static void tm_counters_print_ratio(const char *name, int id,
+                                    unsigned long long num,
+                                    unsigned long long den)
+{
+    unsigned long long hundredths;
+
+    if (tm_counters_fd[id] < 0 || den == 0) {
+        tm_printf(" %s n/a", name);
+        return;
+    }
+    hundredths = num * 100ULL / den;
+    tm_printf(" %s ", name);
+    tm_print_fixed2((unsigned long) hundredths);
+}
+
+void tm_counters_report(unsigned long ops)
+{
+    unsigned long long now[TM_CNT_NUM], delta[TM_CNT_NUM];
+    int i;
+
+    tm_counters_read(now);
+    for (i = 0; i < TM_CNT_NUM; i++) {
+        delta[i] = now[i] - tm_counters_last[i];
+        tm_counters_last[i] = now[i];
+    }
+
+    tm_printf("Counters: ");
+    if (tm_counters_fd[TM_CNT_CYCLES] >= 0)
+        tm_counters_print_ratio("IPC", TM_CNT_INSTRUCTIONS,
+                                delta[TM_CNT_INSTRUCTIONS],
+                                delta[TM_CNT_CYCLES]);
+    else
+        tm_printf(" IPC n/a");
+    tm_printf(", per op:");
+    tm_counters_print_ratio("insns", TM_CNT_INSTRUCTIONS,
+                            delta[TM_CNT_INSTRUCTIONS], ops);
+    tm_counters_print_ratio("cycles", TM_CNT_CYCLES, delta[TM_CNT_CYCLES],
+                            ops);
+    tm_counters_print_ratio("br-miss", TM_CNT_BRANCH_MISSES,
+                            delta[TM_CNT_BRANCH_MISSES], ops);
+    tm_counters_print_ratio("cache-miss", TM_CNT_CACHE_MISSES,
+                            delta[TM_CNT_CACHE_MISSES], ops);
+    if (tm_counters_fd[TM_CNT_CONTEXT_SWITCHES] >= 0)
+        tm_printf(", ctx-switches %lu\n",
+                  (unsigned long) delta[TM_CNT_CONTEXT_SWITCHES]);
+    else
+        tm_printf(", ctx-switches n/a\n");
+}
@@ -0,0 +1,100 @@
+/*
+ * One-time host setup for POSIX builds.
+ *
+ * Runs from main() on the initial thread, before the RTOS creates any
+ * pthreads, so that per-process state set up here (inherited perf
+ * counters, CPU affinity, locked memory) covers every simulator thread.
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "tm_api.h"
+#include "tm_host.h"
+
+#ifndef TM_HOST_CPU
+#define TM_HOST_CPU 0
+#endif
+
+#ifdef TM_HOST_REALTIME
+/* Realtime mode: pin the process to one core and lock its memory.
+ * Affinity is set on the initial thread only; pthread_create() copies
+ * it to every thread created afterwards (scheduler, timer and task
+ * threads alike), so the whole simulator shares a single core.
+ */
+static void tm_host_realtime_init(void)
+{
+    const char *env;
+    char *end;
+    long val;
+    int cpu = TM_HOST_CPU;
+
+    env = getenv("TM_HOST_CPU");
+    if (env) {
+        errno = 0;
+        val = strtol(env, &end, 10);
+        if (errno == 0 && end != env && *end == '\0' && val >= 0 &&
+            val <= INT_MAX)
+            cpu = (int) val;
+    }
+
+#ifdef __linux__
+    {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) == 0)
+            tm_printf("Realtime: pinned to CPU %d\n", cpu);
+        else
+            tm_printf("Realtime: CPU %d pinning FAILED (%s)\n", cpu,
+                      strerror(errno));
+    }
+#else
+    tm_printf("Realtime: CPU pinning not supported on this host\n");
+#endif
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+        tm_printf("Realtime: memory locked\n");
+    else
+        tm_printf("Realtime: mlockall FAILED (%s)\n", strerror(errno));
+}
+#endif /* TM_HOST_REALTIME */
+
+void tm_host_init(void)
+{
+#ifdef TM_HOST_REALTIME
+    tm_host_realtime_init();
+#endif
+#ifdef TM_VIRTUAL_TIME
+    tm_vtime_init();
+#endif
+#ifdef TM_HOST_NOISE
+    tm_noise_init();
+#endif
+#ifdef TM_HOST_COUNTERS
+    tm_counters_init();
+#endif
+}
+
+/* Non-zero if the thread really runs under SCHED_FIFO.  Ports that ask
+ * for real-time priorities use this to report whether the request took
+ * effect instead of assuming it did.
+ */
+int tm_host_thread_is_fifo(pthread_t thread)
+{
+    struct sched_param sp;
+    int policy;
+
+    if (pthread_getschedparam(thread, &policy, &sp) != 0)
+        return 0;
+    return policy == SCHED_FIFO;
+}
@@ -0,0 +1,60 @@
+/*
+ * Host-side helpers for POSIX builds of Thread-Metric.
+ *
+ * RTOS-neutral -- shared by all POSIX porting layers, in the same way
+ * ports/common/cortex-m/ is shared by the Cortex-M ones.  Nothing here
+ * is visible to the tests; only main.c, tm_port.c and tm_report.c use
+ * these declarations.
+ */
+
+#ifndef TM_HOST_H
+#define TM_HOST_H
+
+#include <pthread.h>
+
+/* One-time host setup, called from main() before the kernel starts so
+ * that every simulator pthread created later inherits its effects.
+ * With TM_HOST_REALTIME this pins the process to one CPU and locks its
+ * memory, printing what was applied.
+ */
+void tm_host_init(void);
+
+/* Non-zero if the given thread's scheduling policy is SCHED_FIFO. */
+int tm_host_thread_is_fifo(pthread_t thread);
+
+/* Thin perf_event_open() wrapper (Linux only).  tm_perf_open() returns
+ * a file descriptor counting user-space events of the whole process,
+ * including threads created after the call, or -1 if the counter is
+ * unavailable.  tm_perf_read() returns 0 on success.
+ */
+int tm_perf_open(unsigned int type, unsigned long long config);
+int tm_perf_read(int fd, unsigned long long *value);
+
+/* Virtual time (TM_VIRTUAL_TIME): one virtual second is TM_VIRTUAL_MIPS
+ * million user-space instructions retired by the benchmark process.
+ */
+int tm_vtime_init(void);
+int tm_vtime_active(void);
+unsigned long long tm_vtime_deadline(int seconds);
+int tm_vtime_expired(unsigned long long deadline);
+unsigned long tm_vtime_mark(void);
+unsigned long tm_vtime_scale(unsigned long total);
+
+/* Host noise detection (TM_HOST_NOISE).  tm_noise_start() opens a
+ * measurement interval; tm_noise_check() closes it, prints a "Host noise:"
+ * line and returns non-zero if the host interfered beyond
+ * TM_NOISE_THRESHOLD.
+ */
+void tm_noise_init(void);
+void tm_noise_start(void);
+int tm_noise_check(void);
+
+/* Hardware counters (TM_HOST_COUNTERS).  tm_counters_report() prints IPC
+ * and per-operation costs for the interval since the last call, given
+ * the number of benchmark operations it completed.
+ */
+void tm_counters_init(void);
+void tm_counters_start(void);
+void tm_counters_report(unsigned long ops);
+
+#endif /* TM_HOST_H */
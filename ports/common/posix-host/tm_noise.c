@@ -0,0 +1,152 @@
+/*
+ * Host noise detection for POSIX builds.
+ *
+ * A noisy neighbour on a shared CI runner steals CPU from the simulator
+ * and shows up as a lower period total that is indistinguishable from a
+ * real regression.  For every reporting interval this samples:
+ *
+ *   - run delay: time the process's threads were runnable but waiting
+ *     for a CPU (sum of /proc/self/task/<tid>/schedstat field 2)
+ *   - involuntary context switches and page faults (getrusage)
+ *   - CPU migrations (perf software event)
+ *
+ * An interval is flagged when the run delay reaches TM_NOISE_THRESHOLD
+ * percent of its wall-clock length, or when it took a major page fault.
+ * The simulator's own threads contribute a little run delay of their
+ * own (the timer thread waiting behind a task on the same core), so the
+ * threshold should stay a few percent above zero.
+ *
+ * Counters that the host does not provide (no /proc on macOS, perf
+ * restricted) are reported as n/a and never flag an interval.
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <time.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#endif
+#include "tm_api.h"
+#include "tm_host.h"
+
+#ifndef TM_NOISE_THRESHOLD
+#define TM_NOISE_THRESHOLD 2
+#endif
+
+struct tm_noise_sample {
+    struct timespec wall;
+    long nivcsw;
+    long minflt;
+    long majflt;
+    unsigned long long migrations;
+    unsigned long long run_delay_ns;
+};
+
+static struct tm_noise_sample tm_noise_last;
+static int tm_noise_migrations_fd = -1;
+static int tm_noise_run_delay_ok;
+
+/* Sum the run-queue wait of every live thread.  Returns 0 on success. */
+static int tm_noise_run_delay(unsigned long long *total)
+{
+    char path[300];
+    DIR *dir;
+    FILE *f;
+    struct dirent *de;
+    unsigned long long run, wait;
+
+    dir = opendir("/proc/self/task");
+    if (!dir)
+        return -1;
+
+    *total = 0;
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] == '.')
+            continue;
+        snprintf(path, sizeof(path), "/proc/self/task/%s/schedstat",
+                 de->d_name);
+        f = fopen(path, "r");
+        if (!f)
+            continue;
+        if (fscanf(f, "%llu %llu", &run, &wait) == 2)
+            *total += wait;
+        fclose(f);
+    }
+    closedir(dir);
+    return 0;
+}
+
+static void tm_noise_sample(struct tm_noise_sample *s)
+{
+    struct rusage ru;
+
+    clock_gettime(CLOCK_MONOTONIC, &s->wall);
+
+    getrusage(RUSAGE_SELF, &ru);
+    s->nivcsw = ru.ru_nivcsw;
+    s->minflt = ru.ru_minflt;
+    s->majflt = ru.ru_majflt;
+
+    s->migrations = 0;
+    tm_perf_read(tm_noise_migrations_fd, &s->migrations);
+
+    tm_noise_run_delay_ok = tm_noise_run_delay(&s->run_delay_ns) == 0;
+}
+
+void tm_noise_init(void)
+{
+#ifdef __linux__
+    tm_noise_migrations_fd =
+        tm_perf_open(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS);
+#endif
+}
+
+void tm_noise_start(void)
+{
+    tm_noise_sample(&tm_noise_last);
+}
+
+int tm_noise_check(void)
+{
+    struct tm_noise_sample now;
+    unsigned long long wall_ns, delay_ns;
+    unsigned long permille = 0;
+    int noisy = 0;
+
+    tm_noise_sample(&now);
+
+    wall_ns = (unsigned long long) (now.wall.tv_sec -
+                                    tm_noise_last.wall.tv_sec) *
+                  1000000000ULL +
+              (unsigned long long) (now.wall.tv_nsec -
+                                    tm_noise_last.wall.tv_nsec);
+    delay_ns = now.run_delay_ns - tm_noise_last.run_delay_ns;
+
+    tm_printf("Host noise:  ");
+    if (tm_noise_run_delay_ok && wall_ns > 0) {
+        permille = (unsigned long) (delay_ns * 1000ULL / wall_ns);
+        tm_printf("run delay %lu ms (%lu.%lu%%), ",
+                  (unsigned long) (delay_ns / 1000000ULL), permille / 10,
+                  permille % 10);
+        if (permille >= TM_NOISE_THRESHOLD * 10UL)
+            noisy = 1;
+    } else {
+        tm_printf("run delay n/a, ");
+    }
+    tm_printf("invol. switches %lu, faults %lu/%lu, ",
+              (unsigned long) (now.nivcsw - tm_noise_last.nivcsw),
+              (unsigned long) (now.minflt - tm_noise_last.minflt),
+              (unsigned long) (now.majflt - tm_noise_last.majflt));
+    if (now.majflt != tm_noise_last.majflt)
+        noisy = 1;
+    if (tm_noise_migrations_fd >= 0)
+        tm_printf("migrations %lu",
+                  (unsigned long) (now.migrations - tm_noise_last.migrations));
+    else
+        tm_printf("migrations n/a");
+    tm_printf("%s\n", noisy ? "  [NOISY]" : "");
+
+    tm_noise_last = now;
+    return noisy;
+}
@@ -0,0 +1,70 @@
+/*
+ * perf_event_open() wrapper for POSIX host builds.
+ *
+ * Counters are opened on the calling thread with inherit=1, so when
+ * this runs from main() before the kernel starts, every simulator
+ * pthread created afterwards (scheduler, timer, task threads) is
+ * counted as well.  A read() on the returned descriptor sums the
+ * parent and all inherited child counters.
+ *
+ * Only user-space hardware events are counted (exclude_kernel), which
+ * keeps the counters usable at perf_event_paranoid <= 2 without root and
+ * removes the host kernel's signal and futex work from the measurement.
+ *
+ * Non-Linux hosts (macOS) have no perf_event; tm_perf_open() returns -1
+ * there and callers fall back to their wall-clock behaviour.
+ */
+
+#include "tm_host.h"
+
+#ifdef __linux__
+
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+int tm_perf_open(unsigned int type, unsigned long long config)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.inherit = 1;
+    /* Software events (migrations, context switches) are raised from
+     * kernel context, so excluding the kernel would count nothing.
+     */
+    if (type != PERF_TYPE_SOFTWARE) {
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+    }
+
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+int tm_perf_read(int fd, unsigned long long *value)
+{
+    if (fd < 0 || read(fd, value, sizeof(*value)) != sizeof(*value))
+        return -1;
+    return 0;
+}
+
+#else
+
+int tm_perf_open(unsigned int type, unsigned long long config)
+{
+    (void) type;
+    (void) config;
+    return -1;
+}
+
+int tm_perf_read(int fd, unsigned long long *value)
+{
+    (void) fd;
+    (void) value;
+    return -1;
+}
+
+#endif /* __linux__ */
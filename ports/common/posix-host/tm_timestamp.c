@@ -0,0 +1,22 @@
+/*
+ * tm_timestamp() for POSIX host builds: CLOCK_MONOTONIC in nanoseconds,
+ * truncated to unsigned long.  Unaffected by TM_VIRTUAL_TIME, which only
+ * changes how long a reporting interval lasts.
+ */
+
+#include <time.h>
+#include "tm_api.h"
+
+unsigned long tm_timestamp(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long) ts.tv_sec * 1000000000UL +
+           (unsigned long) ts.tv_nsec;
+}
+
+unsigned long tm_timestamp_frequency(void)
+{
+    return 1000000000UL;
+}
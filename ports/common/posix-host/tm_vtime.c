@@ -0,0 +1,117 @@
+/*
+ * Virtual time for POSIX host builds.
+ *
+ * On a shared host the wall-clock reporting interval is the dominant
+ * noise source: how many operations fit in "30 seconds" depends on
+ * frequency scaling, co-tenants and the host scheduler.  With
+ * TM_VIRTUAL_TIME the reporting interval is instead measured in
+ * user-space instructions retired by the whole benchmark process, so
+ * every interval performs (almost) the same amount of work.
+ *
+ * The reporter thread still sleeps on the RTOS tick; tm_thread_sleep()
+ * in the port just keeps sleeping in short steps until the instruction
+ * budget is spent.  The small overshoot past the deadline is removed
+ * by tm_vtime_scale(), which normalises each period total to exactly
+ * one interval's worth of instructions.
+ *
+ * If the counter cannot be opened (non-Linux host, perf_event_paranoid
+ * too strict, running under a VM without a PMU) the build falls back to
+ * wall-clock intervals with a warning.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#endif
+#include "tm_api.h"
+#include "tm_host.h"
+
+#ifndef TM_VIRTUAL_MIPS
+#define TM_VIRTUAL_MIPS 100
+#endif
+
+static int tm_vtime_fd = -1;
+static unsigned long tm_vtime_mips = TM_VIRTUAL_MIPS;
+static unsigned long long tm_vtime_last;
+static unsigned long long tm_vtime_elapsed;
+
+static unsigned long long tm_vtime_now(void)
+{
+    unsigned long long value = 0;
+
+    tm_perf_read(tm_vtime_fd, &value);
+    return value;
+}
+
+int tm_vtime_init(void)
+{
+    const char *env;
+    char *end;
+    long val;
+
+    env = getenv("TM_VIRTUAL_MIPS");
+    if (env) {
+        errno = 0;
+        val = strtol(env, &end, 10);
+        if (errno == 0 && end != env && *end == '\0' && val > 0 &&
+            val <= INT_MAX)
+            tm_vtime_mips = (unsigned long) val;
+    }
+
+#ifdef __linux__
+    tm_vtime_fd = tm_perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+#endif
+    if (tm_vtime_fd < 0) {
+        tm_printf("Thread-Metric: instruction counter unavailable, "
+                  "virtual time disabled\n");
+        return -1;
+    }
+
+    tm_printf("Thread-Metric: virtual time, 1 s = %lu M instructions\n",
+              tm_vtime_mips);
+    return 0;
+}
+
+int tm_vtime_active(void)
+{
+    return tm_vtime_fd >= 0;
+}
+
+/* Instruction count at which a sleep of the given length ends. */
+unsigned long long tm_vtime_deadline(int seconds)
+{
+    return tm_vtime_now() +
+           (unsigned long long) seconds * tm_vtime_mips * 1000000ULL;
+}
+
+int tm_vtime_expired(unsigned long long deadline)
+{
+    return tm_vtime_now() >= deadline;
+}
+
+/* Start a new interval.  Returns the length of the one just closed in
+ * millions of instructions and keeps the exact value for scaling.
+ */
+unsigned long tm_vtime_mark(void)
+{
+    unsigned long long now = tm_vtime_now();
+
+    tm_vtime_elapsed = now - tm_vtime_last;
+    tm_vtime_last = now;
+    return (unsigned long) (tm_vtime_elapsed / 1000000ULL);
+}
+
+/* Normalise a period total to the nominal interval budget. */
+unsigned long tm_vtime_scale(unsigned long total)
+{
+    unsigned long long budget;
+
+    if (tm_vtime_elapsed == 0)
+        return total;
+
+    budget = (unsigned long long) tm_test_duration * tm_vtime_mips * 1000000ULL;
+    return (unsigned long) ((double) total * (double) budget /
+                            (double) tm_vtime_elapsed);
+}
@@ -0,0 +1,20 @@
+/*
+ * tm_timestamp() for the QEMU RISC-V virt machine.
+ *
+ * The CLINT MTIME counter runs from reset at 10 MHz and is never
+ * written, so it needs no setup.  RV32 returns its low word, which
+ * wraps like every other tm_timestamp() source.
+ */
+
+#include "clint.h"
+#include "tm_api.h"
+
+unsigned long tm_timestamp(void)
+{
+    return (unsigned long) clint_mtime();
+}
+
+unsigned long tm_timestamp_frequency(void)
+{
+    return CLINT_MTIME_HZ;
+}
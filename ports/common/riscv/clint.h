@@ -0,0 +1,60 @@
+/*
+ * SiFive-compatible CLINT, as found on the QEMU RISC-V virt machine.
+ *
+ * Per hart: MSIP (machine software interrupt pending, bit 0) at
+ * 0x02000000 + 4 * hart and MTIMECMP at 0x02004000 + 8 * hart.  MTIME is
+ * shared at 0x0200BFF8 and counts at 10 MHz.  The machine timer
+ * interrupt (mcause 7) is pending while MTIME >= MTIMECMP; the machine
+ * software interrupt (mcause 3) while MSIP is set.  Only hart 0 runs.
+ */
+
+#ifndef CLINT_H
+#define CLINT_H
+
+#include <stdint.h>
+
+#define CLINT_BASE 0x02000000UL
+#define CLINT_MSIP (*(volatile uint32_t *) (CLINT_BASE + 0x0000UL))
+#define CLINT_MTIMECMP_ADDR (CLINT_BASE + 0x4000UL)
+#define CLINT_MTIME_ADDR (CLINT_BASE + 0xBFF8UL)
+
+#define CLINT_MTIME_HZ 10000000UL
+
+/* mie / mip bits and mcause codes of the two CLINT interrupts. */
+#define CLINT_MIE_MSIE (1UL << 3)
+#define CLINT_MIE_MTIE (1UL << 7)
+#define CLINT_CAUSE_MSI 3
+#define CLINT_CAUSE_MTI 7
+
+static inline uint64_t clint_mtime(void)
+{
+#if __riscv_xlen == 64
+    return *(volatile uint64_t *) CLINT_MTIME_ADDR;
+#else
+    volatile uint32_t *mtime = (volatile uint32_t *) CLINT_MTIME_ADDR;
+    uint32_t hi, lo;
+
+    /* Re-read when the low word carried into the high word. */
+    do {
+        hi = mtime[1];
+        lo = mtime[0];
+    } while (hi != mtime[1]);
+    return ((uint64_t) hi << 32) | lo;
+#endif
+}
+
+static inline void clint_set_mtimecmp(uint64_t value)
+{
+#if __riscv_xlen == 64
+    *(volatile uint64_t *) CLINT_MTIMECMP_ADDR = value;
+#else
+    volatile uint32_t *mtimecmp = (volatile uint32_t *) CLINT_MTIMECMP_ADDR;
+
+    /* Never let the intermediate value fall below MTIME. */
+    mtimecmp[1] = 0xFFFFFFFFUL;
+    mtimecmp[0] = (uint32_t) value;
+    mtimecmp[1] = (uint32_t) (value >> 32);
+#endif
+}
+
+#endif /* CLINT_H */
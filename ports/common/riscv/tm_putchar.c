@@ -0,0 +1,60 @@
+/*
+ * RISC-V semihosting primitives for QEMU virt builds.
+ *
+ * RTOS-neutral -- shared by all RISC-V porting layers.
+ * Compiled only when TM_SEMIHOSTING is defined.
+ *
+ * RISC-V semihosting reuses the ARM operation numbers.  A request is an
+ * ebreak framed by two marker instructions ("slli x0, x0, 0x1f" before,
+ * "srai x0, x0, 7" after), all uncompressed and inside one page, with
+ * the operation in a0 and its argument in a1.  QEMU recognises the
+ * sequence in machine mode with -semihosting-config enable=on.
+ */
+
+#include "tm_api.h"
+
+static inline long tm_semihosting_call(long op, void *arg)
+{
+    register long a0 __asm__("a0") = op;
+    register void *a1 __asm__("a1") = arg;
+
+    __asm__ volatile(
+        ".option push\n\t"
+        ".option norvc\n\t"
+        ".balign 16\n\t"
+        "slli x0, x0, 0x1f\n\t"
+        "ebreak\n\t"
+        "srai x0, x0, 7\n\t"
+        ".option pop"
+        : "+r"(a0)
+        : "r"(a1)
+        : "memory");
+    return a0;
+}
+
+void tm_putchar(int c)
+{
+    /* SYS_WRITEC (0x03): a1 points at the character. */
+    char ch = (char) c;
+
+    tm_semihosting_call(0x03, &ch);
+}
+
+void tm_semihosting_exit(int code)
+{
+    /* SYS_EXIT (0x18).  ADP_Stopped_ApplicationExit = 0x20026.  RV32
+     * passes the reason in a1 directly, like ARM M-profile; RV64 follows
+     * the AArch64 convention of a block holding the reason and the exit
+     * code.
+     */
+    unsigned long reason = code == 0 ? 0x20026 : 0x20024;
+#if __riscv_xlen == 64
+    unsigned long block[2] = {reason, (unsigned long) code};
+
+    tm_semihosting_call(0x18, block);
+#else
+    tm_semihosting_call(0x18, (void *) reason);
+#endif
+    for (;;)
+        ;
+}
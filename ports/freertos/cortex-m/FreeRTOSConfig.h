@@ -1,16 +1,60 @@
 /*
- * FreeRTOS configuration for Cortex-M3 on QEMU mps2-an385.
+ * FreeRTOS configuration for Cortex-M3 on QEMU mps2-an385, Cortex-M4F
+ * on mps2-an386 and Cortex-M33 on mps2-an505.
  *
  * MPS2 AN385: Cortex-M3, 25 MHz, 4 MB FLASH + 4 MB SSRAM.
- * FreeRTOS ARM_CM3 port uses PendSV for context switch, SVC for
- * first-task start, and SysTick for tick generation.
+ * MPS2 AN386: the same board with a Cortex-M4F.
+ * MPS2+ AN505: Cortex-M33 with the Security Extension, 20 MHz.
+ * FreeRTOS ARM_CM3/ARM_CM4F ports use PendSV for context switch, SVC
+ * for first-task start, and SysTick for tick generation.  ARM_CM4F also
+ * saves s16-s31 for tasks that have used the FPU and turns on lazy
+ * stacking (FPCCR.ASPEN/LSPEN) when the scheduler starts.  The ARMv8-M
+ * ports name their handlers SVC_Handler/PendSV_Handler/SysTick_Handler
+ * directly, and also switch PSPLIM; with TrustZone (ARM_CM33) PendSV
+ * saves and restores the secure context of tasks that allocated one.
+ * With TM_MPU the ARM_CM3_MPU/ARM_CM4_MPU ports also reprogram the
+ * task's MPU regions in PendSV.
+ * This header is also included by the secure image's context manager.
  */
 
 #ifndef FREERTOS_CONFIG_H
 #define FREERTOS_CONFIG_H
 
 /* Hardware */
+#ifdef TM_MPS2_AN505
+#define configCPU_CLOCK_HZ ((unsigned long) 20000000)
+#else
 #define configCPU_CLOCK_HZ ((unsigned long) 25000000)
+#endif
+
+/* ARMv8-M ports: no FPU or MPU.  The benchmark runs Secure-only on
+ * ARM_CM33_NTZ, or Non-secure on ARM_CM33 with secure contexts for the
+ * tasks that call portALLOCATE_SECURE_CONTEXT().
+ */
+#ifdef TM_MPS2_AN505
+#define configENABLE_FPU 0
+#define configENABLE_MPU 0
+#ifdef TM_TRUSTZONE
+#define configENABLE_TRUSTZONE 1
+#define configRUN_FREERTOS_SECURE_ONLY 0
+#define configMINIMAL_SECURE_STACK_SIZE 256
+#else
+#define configENABLE_TRUSTZONE 0
+#define configRUN_FREERTOS_SECURE_ONLY 1
+#endif
+#endif
+
+/* MPU ports (TM_MPU): API calls go through the v2 wrappers, which hand
+ * out kernel object handles from a fixed pool.  The benchmark tasks are
+ * privileged (tm_port.c), so the wrappers call straight through without
+ * a system call.
+ */
+#ifdef TM_MPU
+#define configUSE_MPU_WRAPPERS_V1 0
+#define configPROTECTED_KERNEL_OBJECT_POOL_SIZE 32
+#define configSYSTEM_CALL_STACK_SIZE 128
+#define configENABLE_ACCESS_CONTROL_LIST 0
+#endif
 
 /* Scheduler */
 #define configUSE_PREEMPTION 1
@@ -21,6 +65,13 @@
 #define configMAX_PRIORITIES 32
 #define configMINIMAL_STACK_SIZE ((unsigned short) 128)
 #define configTOTAL_HEAP_SIZE ((size_t) 32768)
+/* Fast-init builds (TM_FAST_INIT) define the heap in tm_port.c, in
+ * .noinit, so startup does not zero 32 KB that heap_4 initialises
+ * itself.  The MPU ports keep it in privileged_data.
+ */
+#if defined(TM_FAST_INIT) && !defined(TM_MPU)
+#define configAPPLICATION_ALLOCATED_HEAP 1
+#endif
 #define configMAX_TASK_NAME_LEN 16
 
 /* Tick */
@@ -57,6 +108,7 @@
 #define INCLUDE_uxTaskPriorityGet 1
 #define INCLUDE_vTaskPrioritySet 1
 #define INCLUDE_xTaskResumeFromISR 1
+#define INCLUDE_uxTaskGetStackHighWaterMark 1 /* also paints stacks */
 
 /* Assert -- disabled for benchmark */
 #define configASSERT(x)
@@ -68,7 +120,8 @@
  * Cortex-M3 NVIC configuration.
  *
  * QEMU mps2-an385 Cortex-M3 implements 3 priority bits (8 levels).
- * FreeRTOS needs configPRIO_BITS to compute BASEPRI masks.
+ * FreeRTOS needs configPRIO_BITS to compute BASEPRI masks.  The
+ * priorities used stay valid on boards that implement more bits.
  */
 #define configPRIO_BITS 3
 
@@ -88,7 +141,7 @@
 
 /*
  * Map FreeRTOS handler names to the weak aliases in vector_table.c.
- * The ARM_CM3 port defines vPortSVCHandler, xPortPendSVHandler, and
+ * The ARM_CM3/ARM_CM4F ports define vPortSVCHandler, xPortPendSVHandler, and
  * xPortSysTickHandler -- redirect them to the standard CMSIS names.
  */
 #define vPortSVCHandler SVC_Handler
@@ -19,6 +19,7 @@
 
 #include <stdbool.h>
 #include "tm_api.h"
+#include "tm_nvic.h"
 
 /* NVIC register addresses (Cortex-M3) */
 #define NVIC_ISER0 (*(volatile unsigned long *) 0xE000E100UL)
@@ -8,6 +8,9 @@
 
 #include <stdio.h>
 #include "tm_api.h"
+#ifndef TM_SEMIHOSTING
+#include "tm_host.h"
+#endif
 
 void tm_main(void);
 
@@ -22,6 +25,9 @@ int main(int argc, char *argv[])
     tm_report_init();
     tm_report_init_argv(argc, argv);
     tm_printf("Thread-Metric: reporting interval = %d s\n", tm_test_duration);
+#ifndef TM_SEMIHOSTING
+    tm_host_init();
+#endif
     tm_main();
     return 0;
 }
@@ -0,0 +1,78 @@
+/*
+ * FreeRTOS configuration for the QEMU RISC-V virt machine (RV32 / RV64).
+ *
+ * The GCC/RISC-V port runs in machine mode.  Its trap handler
+ * (freertos_risc_v_trap_handler, installed in mtvec by
+ * tm_isr_dispatch_init()) handles ecall yields and the CLINT machine
+ * timer tick itself, and passes every other interrupt to
+ * freertos_risc_v_application_interrupt_handler(), which
+ * tm_isr_dispatch.c provides for the software interrupt behind
+ * tm_cause_interrupt().  Interrupts run on a dedicated ISR stack.
+ * This header is also included by portASM.S, so it holds macros only.
+ */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+/* Hardware: the port derives the tick from MTIME, so the "CPU clock" is
+ * the 10 MHz MTIME rate, not the instruction rate.
+ */
+#define configCPU_CLOCK_HZ ((unsigned long) 10000000)
+#define configMTIME_BASE_ADDRESS (0x0200BFF8UL)
+#define configMTIMECMP_BASE_ADDRESS (0x02004000UL)
+#define configISR_STACK_SIZE_WORDS 512
+
+/* Scheduler */
+#define configUSE_PREEMPTION 1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION 1
+#define configUSE_TIME_SLICING 1
+
+/* Sizing: stacks are counted in words, so the heap scales with XLEN. */
+#define configMAX_PRIORITIES 32
+#define configMINIMAL_STACK_SIZE ((unsigned short) 128)
+#define configTOTAL_HEAP_SIZE ((size_t) (8192 * sizeof(void *)))
+#define configMAX_TASK_NAME_LEN 16
+
+/* Tick */
+#define configTICK_RATE_HZ ((TickType_t) 1000)
+#define configUSE_16_BIT_TICKS 0
+
+/* Features */
+#define configUSE_MUTEXES 0
+#define configUSE_COUNTING_SEMAPHORES 0
+#define configUSE_RECURSIVE_MUTEXES 0
+#define configUSE_QUEUE_SETS 0
+
+/* Hooks */
+#define configUSE_IDLE_HOOK 0
+#define configUSE_TICK_HOOK 0
+#define configUSE_MALLOC_FAILED_HOOK 0
+#define configCHECK_FOR_STACK_OVERFLOW 0
+
+/* Timer daemon */
+#define configUSE_TIMERS 0
+#define configTIMER_TASK_PRIORITY 2
+#define configTIMER_QUEUE_LENGTH 10
+#define configTIMER_TASK_STACK_DEPTH configMINIMAL_STACK_SIZE
+
+/* Co-routines */
+#define configUSE_CO_ROUTINES 0
+#define configMAX_CO_ROUTINE_PRIORITIES 1
+
+/* INCLUDE functions needed by Thread-Metric */
+#define INCLUDE_vTaskSuspend 1
+#define INCLUDE_vTaskDelay 1
+#define INCLUDE_vTaskDelete 1
+#define INCLUDE_xTaskGetSchedulerState 1
+#define INCLUDE_uxTaskPriorityGet 1
+#define INCLUDE_vTaskPrioritySet 1
+#define INCLUDE_xTaskResumeFromISR 1
+#define INCLUDE_uxTaskGetStackHighWaterMark 1 /* also paints stacks */
+
+/* Assert -- disabled for benchmark */
+#define configASSERT(x)
+
+/* Trace */
+#define configUSE_TRACE_FACILITY 0
+
+#endif /* FREERTOS_CONFIG_H */
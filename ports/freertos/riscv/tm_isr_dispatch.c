@@ -0,0 +1,113 @@
+/*
+ * FreeRTOS RISC-V interrupt dispatch for Thread-Metric (QEMU virt).
+ *
+ * tm_cause_interrupt() sets the hart's CLINT MSIP bit.  The machine
+ * software interrupt enters the port's freertos_risc_v_trap_handler,
+ * which saves the task context, switches to the ISR stack and, since
+ * it is not the timer, calls freertos_risc_v_application_interrupt_handler()
+ * below; that clears MSIP and calls the benchmark interrupt handlers.
+ * A FromISR call that readies a higher-priority task has
+ * portYIELD_FROM_ISR() select it, and the port restores that task on
+ * the way out.
+ *
+ * tm_isr_dispatch_init() installs the port's trap handler in mtvec and
+ * enables the software interrupt in mie; the port enables the timer
+ * interrupt itself when the scheduler starts.  Called from
+ * tm_initialize() before the scheduler starts.
+ *
+ * The port has no xPortIsInsideInterrupt(), so the dispatcher counts
+ * its own handlers for tm_port.c (tm_isr_dispatch_depth()).
+ *
+ * Both handlers have weak no-op defaults here.  The strong definition
+ * from whichever interrupt test is linked overrides the no-op.  The
+ * CLINT has a single software interrupt per hart and no priority
+ * levels, so there are no nested interrupt sources on this target.
+ */
+
+#include <stdbool.h>
+#include "clint.h"
+#include "tm_api.h"
+
+#define TM_RISCV_MCAUSE_INTERRUPT (1UL << (__riscv_xlen - 1))
+#define TM_RISCV_MSTATUS_MIE 0x8UL
+
+__attribute__((weak)) void tm_interrupt_handler(void) {}
+__attribute__((weak)) void tm_interrupt_preemption_handler(void) {}
+
+extern void freertos_risc_v_trap_handler(void);
+extern void tm_freertos_sync_complete(void);
+
+void freertos_risc_v_application_interrupt_handler(void);
+
+/* Benchmark-only interrupt-context marker used by tm_cause_interrupt_sync(),
+ * and the nesting of real handlers (the port does not nest interrupts).
+ */
+static volatile bool tm_benchmark_interrupt_active;
+static volatile int tm_isr_depth;
+
+/* Overrides the port's weak default, which spins. */
+void freertos_risc_v_application_interrupt_handler(void)
+{
+    unsigned long mcause;
+
+    __asm volatile("csrr %0, mcause" : "=r"(mcause));
+    if (mcause != (TM_RISCV_MCAUSE_INTERRUPT | CLINT_CAUSE_MSI))
+        tm_check_fail("FATAL: unexpected RISC-V interrupt\n");
+
+    CLINT_MSIP = 0;
+    tm_isr_depth++;
+    tm_interrupt_handler();
+    tm_interrupt_preemption_handler();
+    tm_isr_depth--;
+}
+
+bool tm_benchmark_interrupt_context_active(void)
+{
+    return tm_benchmark_interrupt_active;
+}
+
+int tm_isr_dispatch_depth(void)
+{
+    return tm_isr_depth;
+}
+
+void tm_isr_dispatch_init(void)
+{
+    unsigned long msie = CLINT_MIE_MSIE;
+
+    CLINT_MSIP = 0;
+    __asm volatile("csrw mtvec, %0" : : "r"(freertos_risc_v_trap_handler));
+    __asm volatile("csrs mie, %0" : : "r"(msie));
+}
+
+/* The handler clears MSIP, so waiting for it keeps the contract that
+ * the handler has run when this returns.  The trap is normally taken
+ * right after the store; the loop covers a delayed delivery.
+ */
+void tm_cause_interrupt(void)
+{
+    CLINT_MSIP = 1;
+    while (CLINT_MSIP)
+        ;
+}
+
+/* Synchronous variant: skip the software interrupt and run the handler
+ * in-line on the caller's stack.  See tm_api.h for the contract
+ * distinction between this and tm_cause_interrupt().
+ *
+ * Interrupts are masked around the flag so a tick cannot switch to a
+ * task that would observe it set in thread context.  A yield the
+ * handler requested is taken once they are back on
+ * (tm_freertos_sync_complete() in tm_port.c).
+ */
+void tm_cause_interrupt_sync(void)
+{
+    __asm volatile("csrc mstatus, %0" : : "r"(TM_RISCV_MSTATUS_MIE)
+                   : "memory");
+    tm_benchmark_interrupt_active = true;
+    tm_interrupt_handler();
+    tm_benchmark_interrupt_active = false;
+    __asm volatile("csrs mstatus, %0" : : "r"(TM_RISCV_MSTATUS_MIE)
+                   : "memory");
+    tm_freertos_sync_complete();
+}
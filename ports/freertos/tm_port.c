@@ -1,9 +1,9 @@
 /*
  * FreeRTOS porting layer for Thread-Metric benchmarks.
  *
- * Implements the 14 functions declared in tm_api.h against the
- * FreeRTOS kernel.  Works on both the POSIX simulator and real
- * Cortex-M hardware (QEMU mps2-an385).
+ * Implements the 16 functions declared in tm_api.h against the
+ * FreeRTOS kernel.  Works on the POSIX simulator, real Cortex-M
+ * hardware (QEMU mps2-an385) and RISC-V (QEMU virt).
  *
  * Key design decisions vs. the external reference:
  *   - Priority mapping: (configMAX_PRIORITIES - 1) - tm_priority
@@ -14,10 +14,16 @@
  *     Fair comparison with ThreadX tx_block_* (not pvPortMalloc).
  *   - Tasks created suspended: xTaskCreate + vTaskSuspend before
  *     scheduler starts (matches ThreadX TX_DONT_START).
- *   - ISR simulation (POSIX): highest-priority task blocks on binary
- *     semaphore.  tm_cause_interrupt() gives it -> immediate preemption.
- *   - ISR-safe Cortex-M: uses xTaskResumeFromISR / xSemaphoreGiveFromISR
- *     when called from interrupt context.
+ *   - MPU ports (TM_MPU): xTaskCreateRestricted with a static stack that
+ *     is the task's own MPU region and a no-access guard region over
+ *     its bottom.  Tasks stay privileged so the tests run unchanged.
+ *   - ISR simulation (POSIX): tm_cause_interrupt() raises a signal on
+ *     the running task's pthread -- the same mechanism the POSIX port
+ *     uses for its tick -- so the handler interrupts the task in place
+ *     instead of being a task of its own.
+ *   - ISR-safe APIs: uses xTaskResumeFromISR / xSemaphoreGiveFromISR /
+ *     xQueueSendToBackFromISR when called from (real or simulated)
+ *     interrupt context.
  */
 
 #include <FreeRTOS.h>
@@ -26,7 +32,18 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <task.h>
+#ifdef TM_ISR_SIMULATED
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#endif
 #include "tm_api.h"
+#ifndef TM_SEMIHOSTING
+#include "tm_host.h"
+#endif
+#ifdef TM_MPU
+#include "tm_mpu.h"
+#endif
 
 
 /* Constants */
@@ -55,9 +72,30 @@ static SemaphoreHandle_t tm_semaphore_array[TM_FREERTOS_MAX_SEMAPHORES];
 /* Entry function table + trampoline (FreeRTOS task signature differs). */
 static void (*tm_thread_entry_functions[TM_FREERTOS_MAX_THREADS])(void);
 
+#ifdef TM_MPU
+/* Each stack is one MPU region: a power of two in size, aligned to it. */
+#define TM_FREERTOS_STACK_BYTES (TM_FREERTOS_STACK_DEPTH * sizeof(StackType_t))
+
+static StackType_t
+    tm_thread_stacks[TM_FREERTOS_MAX_THREADS][TM_FREERTOS_STACK_DEPTH]
+    __attribute__((aligned(TM_FREERTOS_STACK_BYTES))) TM_NOINIT;
+
+/* tskSTACK_FILL_BYTE: what the kernel paints new stacks with. */
+#define TM_FREERTOS_STACK_FILL 0xa5U
+#endif
+
+#if configAPPLICATION_ALLOCATED_HEAP
+/* heap_4 builds its free list over this itself (TM_FAST_INIT). */
+uint8_t ucHeap[configTOTAL_HEAP_SIZE] TM_NOINIT;
+#endif
+
 static void tm_task_trampoline(void *param)
 {
     int id = (int) (unsigned long) param;
+#ifdef TM_BOOT_TIME
+    /* The first task to get here ends the boot-time measurement. */
+    tm_report_boot_mark();
+#endif
     tm_thread_entry_functions[id]();
     /* Benchmark threads loop forever, but guard against accidental
      * return -- FreeRTOS tasks must not fall off the end.
@@ -68,9 +106,11 @@ static void tm_task_trampoline(void *param)
 
 /* O(1) fixed-block memory pool (no kernel involvement) */
 
-/* Pool storage -- aligned for any basic type. */
+/* Pool storage -- aligned for any basic type.  tm_memory_pool_create()
+ * writes the whole freelist, so TM_NOINIT.
+ */
 static unsigned char tm_pool_area[TM_FREERTOS_MAX_POOLS][TM_POOL_SIZE]
-    __attribute__((aligned(sizeof(void *))));
+    __attribute__((aligned(sizeof(void *)))) TM_NOINIT;
 
 /* Freelist head per pool.  Each free block stores a pointer to the
  * next free block in its first sizeof(void*) bytes.
@@ -78,57 +118,173 @@ static unsigned char tm_pool_area[TM_FREERTOS_MAX_POOLS][TM_POOL_SIZE]
 static void *tm_pool_free[TM_FREERTOS_MAX_POOLS];
 
 
-/* ISR simulation -- POSIX host */
+/* ISR simulation -- POSIX host
+ *
+ * The FreeRTOS POSIX port delivers its tick as SIGALRM to the pthread of
+ * the running task; the handler is the port's interrupt context.
+ * tm_cause_interrupt() does the same with TM_ISR_SIGNAL, sent to the
+ * calling task's own pthread, so the benchmark handlers run on the
+ * interrupted task's stack with every other signal masked, using the
+ * FromISR APIs.  A context switch requested by the handler is taken
+ * after the signal handler returns -- the simulator's PendSV.
+ */
 
-#ifdef TM_ISR_VIA_THREAD
+#ifdef TM_ISR_SIMULATED
 
-static TaskHandle_t tm_isr_task;
-static SemaphoreHandle_t tm_isr_sem;
+#define TM_ISR_SIGNAL SIGUSR2
 
 __attribute__((weak)) void tm_interrupt_handler(void) {}
 __attribute__((weak)) void tm_interrupt_preemption_handler(void) {}
 
-static void tm_isr_task_entry(void *param)
+static volatile bool tm_benchmark_interrupt_active;
+static volatile BaseType_t tm_isr_yield_pending;
+
+/* Record a handler's yield request instead of switching inside the
+ * signal handler.
+ */
+#define TM_YIELD_FROM_ISR(yield)           \
+    do {                                   \
+        if (yield)                         \
+            tm_isr_yield_pending = pdTRUE; \
+    } while (0)
+
+static void tm_isr_signal_handler(int sig)
+{
+    (void) sig;
+    tm_benchmark_interrupt_active = true;
+    tm_interrupt_handler();
+    tm_interrupt_preemption_handler();
+    tm_benchmark_interrupt_active = false;
+}
+
+static void tm_isr_init(void)
+{
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = tm_isr_signal_handler;
+    sigfillset(&sa.sa_mask);
+    if (sigaction(TM_ISR_SIGNAL, &sa, NULL) != 0)
+        tm_check_fail("FATAL: ISR simulation setup failed\n");
+}
+
+static bool tm_isr_context_active(void)
 {
-    (void) param;
-    for (;;) {
-        xSemaphoreTake(tm_isr_sem, portMAX_DELAY);
-        tm_interrupt_handler();
-        tm_interrupt_preemption_handler();
+    return tm_benchmark_interrupt_active;
+}
+
+/* Interrupt exit: take the context switch the handler asked for. */
+static void tm_isr_exit(void)
+{
+    if (tm_isr_yield_pending) {
+        tm_isr_yield_pending = pdFALSE;
+        taskYIELD();
     }
 }
 
 void tm_cause_interrupt(void)
 {
-    xSemaphoreGive(tm_isr_sem);
+    /* A signal sent to the calling thread is delivered before
+     * pthread_kill() returns.
+     */
+    pthread_kill(pthread_self(), TM_ISR_SIGNAL);
+    tm_isr_exit();
 }
 
-/* Synchronous variant: skip the ISR-task round-trip and run the
- * handler in-line on the caller's stack. See tm_api.h for the
- * contract distinction between this and tm_cause_interrupt().
+/* Synchronous variant: skip the signal round-trip and run the handler
+ * in-line on the caller's stack. See tm_api.h for the contract
+ * distinction between this and tm_cause_interrupt().  Signals (the
+ * tick) are masked around the flag so no task switch can observe it.
  */
 void tm_cause_interrupt_sync(void)
 {
+    portDISABLE_INTERRUPTS();
+    tm_benchmark_interrupt_active = true;
     tm_interrupt_handler();
+    tm_benchmark_interrupt_active = false;
+    portENABLE_INTERRUPTS();
+    tm_isr_exit();
 }
 
-#endif /* TM_ISR_VIA_THREAD */
+#endif /* TM_ISR_SIMULATED */
 
 
 /* Cortex-M ISR dispatch (provided by tm_isr_dispatch.c) */
 
-#if defined(__arm__) && !defined(TM_ISR_VIA_THREAD)
+#if defined(__arm__) && !defined(TM_ISR_SIMULATED)
 extern void tm_isr_dispatch_init(void);
 extern bool tm_benchmark_interrupt_context_active(void);
 /* tm_cause_interrupt() defined in tm_isr_dispatch.c */
+
+static bool tm_isr_context_active(void)
+{
+    return xPortIsInsideInterrupt() || tm_benchmark_interrupt_context_active();
+}
+
+#define TM_YIELD_FROM_ISR(yield) portYIELD_FROM_ISR(yield)
 #endif
 
 
+/* RISC-V ISR dispatch (provided by riscv/tm_isr_dispatch.c) */
+
+#if defined(__riscv) && !defined(TM_ISR_SIMULATED)
+extern void tm_isr_dispatch_init(void);
+extern bool tm_benchmark_interrupt_context_active(void);
+extern int tm_isr_dispatch_depth(void);
+void tm_freertos_sync_complete(void);
+
+static volatile BaseType_t tm_isr_yield_pending;
+
+static bool tm_isr_context_active(void)
+{
+    return tm_isr_dispatch_depth() != 0 ||
+           tm_benchmark_interrupt_context_active();
+}
+
+/* In a real handler portYIELD_FROM_ISR() picks the task the port's trap
+ * exit restores.  The inline tm_cause_interrupt_sync() path runs in
+ * task context, where that would swap the current task under the
+ * running one, so record the request and yield afterwards instead.
+ */
+#define TM_YIELD_FROM_ISR(yield)                   \
+    do {                                           \
+        if ((yield) && tm_isr_dispatch_depth())    \
+            portYIELD_FROM_ISR(yield);             \
+        else if (yield)                            \
+            tm_isr_yield_pending = pdTRUE;         \
+    } while (0)
+
+void tm_freertos_sync_complete(void)
+{
+    if (tm_isr_yield_pending) {
+        tm_isr_yield_pending = pdFALSE;
+        taskYIELD();
+    }
+}
+#endif
+
+
+/* Kernel view of interrupt context, for tests that check ISR bookkeeping.
+ * Unlike tm_isr_context_active(), ignores the benchmark-only flag of
+ * tm_cause_interrupt_sync() on Cortex-M and RISC-V.
+ */
+int tm_isr_context(void)
+{
+#ifdef TM_ISR_SIMULATED
+    return tm_isr_context_active();
+#elif defined(__riscv)
+    return tm_isr_dispatch_depth() != 0;
+#else
+    return xPortIsInsideInterrupt() == pdTRUE;
+#endif
+}
+
+
 /* tm_initialize */
 
 void tm_initialize(void (*test_initialization_function)(void))
 {
-#if defined(__arm__) && !defined(TM_ISR_VIA_THREAD)
+#if defined(__arm__) && !defined(TM_ISR_SIMULATED)
     /* Set PendSV and SysTick to the lowest interrupt priority before
      * any task creation.  The FreeRTOS ARM_CM3 port normally does this
      * inside xPortStartScheduler(), but vTaskResume() can pend PendSV
@@ -144,23 +300,22 @@ void tm_initialize(void (*test_initialization_function)(void))
     }
 #endif
 
-#ifdef TM_ISR_VIA_THREAD
-    /* ISR simulation thread at highest FreeRTOS priority.
-     * Created before the test threads so it exists when
-     * tm_cause_interrupt() is called.
-     */
-    tm_isr_sem = xSemaphoreCreateBinary();
-    if (tm_isr_sem == NULL ||
-        xTaskCreate(tm_isr_task_entry, "ISR", TM_FREERTOS_STACK_DEPTH, NULL,
-                    configMAX_PRIORITIES - 1, &tm_isr_task) != pdPASS) {
-        tm_check_fail("FATAL: ISR simulation setup failed\n");
-    }
+#ifdef TM_ISR_SIMULATED
+    tm_isr_init();
 #endif
 
     /* Let the test create its threads. */
     test_initialization_function();
 
-#if defined(__arm__) && !defined(TM_ISR_VIA_THREAD)
+#ifdef TM_HOST_REALTIME
+    /* The FreeRTOS POSIX port runs its tick on a separate pthread that
+     * must preempt a busy task; with every thread pinned to one core
+     * that only works under the default time-shared policy.
+     */
+    tm_printf("Realtime: SCHED_FIFO not used by the FreeRTOS POSIX port\n");
+#endif
+
+#if (defined(__arm__) || defined(__riscv)) && !defined(TM_ISR_SIMULATED)
     tm_isr_dispatch_init();
 #endif
 
@@ -181,15 +336,35 @@ int tm_thread_create(int thread_id, int priority, void (*entry_function)(void))
         return TM_ERROR;
 
     /* Invert priority: TM 1 (highest) -> configMAX_PRIORITIES-2,
-     * TM 31 (lowest) -> 0.  Reserve configMAX_PRIORITIES-1 for ISR.
+     * TM 31 (lowest) -> 0.  configMAX_PRIORITIES-1 stays unused.
      */
     freertos_prio = (UBaseType_t) ((configMAX_PRIORITIES - 1) - priority);
 
     tm_thread_entry_functions[thread_id] = entry_function;
 
+#ifdef TM_MPU
+    {
+        /* The port programs the stack region itself; the first
+         * configurable region, numbered above it, is the guard.
+         */
+        TaskParameters_t params = {
+            .pvTaskCode = tm_task_trampoline,
+            .pcName = "TM",
+            .usStackDepth = TM_FREERTOS_STACK_DEPTH,
+            .pvParameters = (void *) (unsigned long) thread_id,
+            .uxPriority = freertos_prio | portPRIVILEGE_BIT,
+            .puxStackBuffer = tm_thread_stacks[thread_id],
+            .xRegions = {{tm_thread_stacks[thread_id], TM_MPU_GUARD_SIZE,
+                          portMPU_REGION_EXECUTE_NEVER}},
+        };
+
+        status = xTaskCreateRestricted(&params, &tm_thread_array[thread_id]);
+    }
+#else
     status = xTaskCreate(tm_task_trampoline, "TM", TM_FREERTOS_STACK_DEPTH,
                          (void *) (unsigned long) thread_id, freertos_prio,
                          &tm_thread_array[thread_id]);
+#endif
 
     if (status != pdPASS)
         return TM_ERROR;
@@ -207,12 +382,12 @@ int tm_thread_resume(int thread_id)
     if (thread_id < 0 || thread_id >= TM_FREERTOS_MAX_THREADS)
         return TM_ERROR;
 
-#if defined(__arm__) && !defined(TM_ISR_VIA_THREAD)
-    /* Cortex-M: detect ISR context for ISR-safe resume. */
-    if (xPortIsInsideInterrupt() || tm_benchmark_interrupt_context_active()) {
+#if defined(TM_ISR_SIMULATED) || defined(__arm__) || defined(__riscv)
+    /* Detect (real or simulated) ISR context for ISR-safe resume. */
+    if (tm_isr_context_active()) {
         BaseType_t yield = pdFALSE;
         yield = xTaskResumeFromISR(tm_thread_array[thread_id]);
-        portYIELD_FROM_ISR(yield);
+        TM_YIELD_FROM_ISR(yield);
         return TM_SUCCESS;
     }
 #endif
@@ -234,11 +409,78 @@ void tm_thread_relinquish(void)
     taskYIELD();
 }
 
+void tm_critical_enter(void)
+{
+    taskENTER_CRITICAL();
+}
+
+void tm_critical_exit(void)
+{
+    taskEXIT_CRITICAL();
+}
+
 void tm_thread_sleep(int seconds)
 {
+#ifdef TM_VIRTUAL_TIME
+    unsigned long long deadline;
+
+    /* Virtual time: poll the instruction budget every 10 ms. */
+    if (tm_vtime_active()) {
+        deadline = tm_vtime_deadline(seconds);
+        while (!tm_vtime_expired(deadline))
+            vTaskDelay(pdMS_TO_TICKS(10));
+        return;
+    }
+#endif
+
     vTaskDelay(pdMS_TO_TICKS(seconds * 1000U));
 }
 
+/* Peak stack usage.  INCLUDE_uxTaskGetStackHighWaterMark makes the kernel
+ * paint each new stack, and the high-water mark is the unpainted depth.
+ * The POSIX port runs tasks on pthread stacks, so only the semihosting
+ * targets measure.  MPU builds scan from above the guard themselves:
+ * the kernel scan starts at the bottom of the stack, which is no-access
+ * for the calling task.
+ */
+int tm_thread_stack_usage(int thread_id,
+                          unsigned long *used,
+                          unsigned long *size)
+{
+#ifdef TM_SEMIHOSTING
+    unsigned long bytes = TM_FREERTOS_STACK_DEPTH * sizeof(StackType_t);
+
+    if (thread_id < 0 || thread_id >= TM_FREERTOS_MAX_THREADS ||
+        tm_thread_array[thread_id] == NULL)
+        return TM_ERROR;
+
+#ifdef TM_MPU
+    {
+        const unsigned char *p =
+            (const unsigned char *) tm_thread_stacks[thread_id];
+        unsigned long unused = TM_MPU_GUARD_SIZE;
+
+        while (unused < bytes && p[unused] == TM_FREERTOS_STACK_FILL)
+            unused++;
+        *used = bytes - unused;
+    }
+#else
+    {
+        TaskHandle_t task = tm_thread_array[thread_id];
+
+        *used = bytes - uxTaskGetStackHighWaterMark(task) * sizeof(StackType_t);
+    }
+#endif
+    *size = bytes;
+    return TM_SUCCESS;
+#else
+    (void) thread_id;
+    (void) used;
+    (void) size;
+    return TM_ERROR;
+#endif
+}
+
 
 /* Queue management */
 
@@ -261,6 +503,17 @@ int tm_queue_send(int queue_id, unsigned long *message_ptr)
     if (queue_id < 0 || queue_id >= TM_FREERTOS_MAX_QUEUES)
         return TM_ERROR;
 
+#if defined(TM_ISR_SIMULATED) || defined(__arm__) || defined(__riscv)
+    if (tm_isr_context_active()) {
+        BaseType_t yield = pdFALSE;
+        if (xQueueSendToBackFromISR(tm_queue_array[queue_id],
+                                    (const void *) message_ptr,
+                                    &yield) != pdTRUE)
+            return TM_ERROR;
+        TM_YIELD_FROM_ISR(yield);
+        return TM_SUCCESS;
+    }
+#endif
     if (xQueueSendToBack(tm_queue_array[queue_id], (const void *) message_ptr,
                          0) != pdTRUE)
         return TM_ERROR;
@@ -315,13 +568,13 @@ int tm_semaphore_put(int semaphore_id)
     if (semaphore_id < 0 || semaphore_id >= TM_FREERTOS_MAX_SEMAPHORES)
         return TM_ERROR;
 
-#if defined(__arm__) && !defined(TM_ISR_VIA_THREAD)
-    if (xPortIsInsideInterrupt() || tm_benchmark_interrupt_context_active()) {
+#if defined(TM_ISR_SIMULATED) || defined(__arm__) || defined(__riscv)
+    if (tm_isr_context_active()) {
         BaseType_t yield = pdFALSE;
         if (xSemaphoreGiveFromISR(tm_semaphore_array[semaphore_id], &yield) !=
             pdTRUE)
             return TM_ERROR;
-        portYIELD_FROM_ISR(yield);
+        TM_YIELD_FROM_ISR(yield);
         return TM_SUCCESS;
     }
 #endif
@@ -392,8 +645,22 @@ int tm_memory_pool_deallocate(int pool_id, unsigned char *memory_ptr)
 }
 
 
+/* TrustZone builds: give the calling task a secure stack, saved and
+ * restored by the ARM_CM33 port's PendSV on every switch of this task.
+ * FreeRTOS reports no status; the secure context manager leaves the
+ * task without a context when its pool is exhausted.
+ */
+#ifdef TM_TRUSTZONE
+int tm_secure_context_allocate(void)
+{
+    portALLOCATE_SECURE_CONTEXT(configMINIMAL_SECURE_STACK_SIZE);
+    return TM_SUCCESS;
+}
+#endif
+
+
 /* Low-level character output for tm_printf().
- * Cortex-M semihosting builds use ports/common/cortex-m/tm_putchar.c instead.
+ * QEMU semihosting builds use ports/common/<arch>/tm_putchar.c instead.
  */
 #ifndef TM_SEMIHOSTING
 void tm_putchar(int c)
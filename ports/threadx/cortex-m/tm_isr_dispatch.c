@@ -19,10 +19,15 @@
  *
  * Both handlers have weak no-op defaults here.  The strong definition
  * from whichever interrupt test is linked overrides the no-op.
+ *
+ * On mps2-an505 the cortex_m33 port takes SVC for its secure stack
+ * services, so tm_cause_interrupt() pends IRQ 31 instead, as the
+ * FreeRTOS dispatch does; its NVIC setup also runs on the first call.
  */
 
 #include <stdbool.h>
 #include "tm_api.h"
+#include "tm_nvic.h"
 
 __attribute__((weak)) void tm_interrupt_handler(void) {}
 __attribute__((weak)) void tm_interrupt_preemption_handler(void) {}
@@ -31,6 +36,31 @@ extern void tm_threadx_benchmark_sync_complete(void);
 
 static volatile bool tm_benchmark_interrupt_active;
 
+#ifdef TM_MPS2_AN505
+#define TM_ISR_IRQ 31
+
+void IRQ31_Handler(void)
+{
+    tm_interrupt_handler();
+    tm_interrupt_preemption_handler();
+}
+
+/* Lowest level the FreeRTOS dispatch uses too; still above PendSV, so
+ * the handler runs before the barriers retire, like the SVC it replaces.
+ */
+void tm_cause_interrupt(void)
+{
+    static bool initialized;
+
+    if (!initialized) {
+        initialized = true;
+        tm_nvic_set_priority(TM_ISR_IRQ, 0xE0);
+        tm_nvic_enable(TM_ISR_IRQ);
+    }
+    tm_nvic_set_pending(TM_ISR_IRQ);
+    __asm volatile("dsb\n\tisb" ::: "memory");
+}
+#else
 void SVC_Handler(void)
 {
     tm_interrupt_handler();
@@ -41,6 +71,7 @@ void tm_cause_interrupt(void)
 {
     __asm volatile("svc #0");
 }
+#endif
 
 bool tm_benchmark_interrupt_context_active(void)
 {
@@ -0,0 +1,71 @@
+/*
+ * ThreadX MPU-protected thread stacks for Thread-Metric (TM_MPU builds,
+ * Cortex-M3/M4F).
+ *
+ * ThreadX confines code with the MPU only through its module manager,
+ * which runs separately linked module images.  The benchmark threads are
+ * ordinary threads, so this file gives them what the FreeRTOS MPU ports
+ * give privileged tasks: on every context switch the incoming thread's
+ * stack is reprogrammed as its own region, with a no-access guard over
+ * its lowest TM_MPU_GUARD_SIZE bytes.
+ *
+ * Built with TX_ENABLE_EXECUTION_CHANGE_NOTIFY, the port's PendSV handler
+ * calls _tx_execution_thread_enter() once it has made the next thread
+ * current and before it restores that thread's registers:
+ *
+ *   region 6: the thread stack, read/write, execute-never
+ *   region 7: the guard at the bottom of it, no access
+ *
+ * Everything else stays on the privileged default memory map
+ * (MPU_CTRL.PRIVDEFENA), and the threads run privileged, so the tests
+ * need no changes.  tm_port.c sizes and aligns the stacks for this.
+ */
+
+#include "tm_api.h"
+#include "tm_mpu.h"
+#include "tx_api.h"
+#include "tx_thread.h"
+
+#define TM_MPU_REGION_STACK 6
+#define TM_MPU_REGION_GUARD 7
+
+void tm_threadx_mpu_init(void);
+
+/* Called from tm_initialize() before the scheduler starts. */
+void tm_threadx_mpu_init(void)
+{
+    if (((TM_MPU_TYPE >> 8) & 0xFF) <= TM_MPU_REGION_GUARD)
+        tm_check_fail("FATAL: MPU with too few regions\n");
+
+    TM_SCB_SHCSR |= TM_SCB_SHCSR_MEMFAULTENA;
+    TM_MPU_CTRL = TM_MPU_CTRL_PRIVDEFENA | TM_MPU_CTRL_ENABLE;
+    __asm volatile("dsb\n\tisb" ::: "memory");
+}
+
+/* Runs in PendSV before the new thread's context is restored; the
+ * exception return orders the MPU writes before the thread's first
+ * access.
+ */
+VOID _tx_execution_thread_enter(void)
+{
+    TX_THREAD *thread = _tx_thread_current_ptr;
+    unsigned long base = (unsigned long) thread->tx_thread_stack_start;
+    unsigned long size = thread->tx_thread_stack_size;
+
+    TM_MPU_RBAR = base | TM_MPU_RBAR_VALID | TM_MPU_REGION_STACK;
+    TM_MPU_RASR = TM_MPU_RASR_XN | TM_MPU_RASR_AP_RW |
+                  TM_MPU_RASR_NORMAL_WB |
+                  TM_MPU_RASR_SIZE(31 - __builtin_clzl(size)) |
+                  TM_MPU_RASR_ENABLE;
+    TM_MPU_RBAR = base | TM_MPU_RBAR_VALID | TM_MPU_REGION_GUARD;
+    TM_MPU_RASR = TM_MPU_RASR_XN | TM_MPU_RASR_AP_NONE |
+                  TM_MPU_RASR_SIZE(TM_MPU_GUARD_LOG2) | TM_MPU_RASR_ENABLE;
+}
+
+/* The remaining execution-change hooks have nothing to do here.
+ * _tx_initialize_kernel_enter() calls _tx_execution_initialize() too.
+ */
+VOID _tx_execution_initialize(void) {}
+VOID _tx_execution_thread_exit(void) {}
+VOID _tx_execution_isr_enter(void) {}
+VOID _tx_execution_isr_exit(void) {}
@@ -2,9 +2,13 @@
  * POSIX host port -- low-level initialization.
  *
  * Differences from the Linux port:
- *   - No CPU affinity (sched_setaffinity is Linux-only).
- *   - Timer uses nanosleep instead of sem_timedwait.
+ *   - No CPU affinity here; realtime mode (TM_HOST_REALTIME) pins the
+ *     whole process from main() instead.
+ *   - Timer sleeps to absolute CLOCK_MONOTONIC deadlines instead of
+ *     sem_timedwait, so ISR cost and wakeup latency do not accumulate.
  *   - SCHED_FIFO is best-effort (non-fatal when unprivileged).
+ *   - A software interrupt thread injects handlers; it and the timer
+ *     thread take one interrupt lock, so interrupts never overlap.
  *
  * SPDX-License-Identifier: MIT
  */
@@ -13,6 +17,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -43,6 +48,38 @@ tx_posix_sem_t _tx_posix_timer_semaphore;
 tx_posix_sem_t _tx_posix_isr_semaphore;
 static void *_tx_posix_timer_interrupt(void *p);
 
+/* Timer statistics, read by the porting layer's end-of-run report.
+ *   ticks    -- timer interrupts delivered to ThreadX
+ *   late     -- wakeups more than a quarter period past their deadline
+ *   overruns -- whole periods that elapsed before the thread woke; each
+ *               is delivered as an extra catch-up tick
+ *   dropped  -- ticks discarded when the timer fell more than one second
+ *               behind and resynchronised instead of catching up
+ *   max_late_us -- worst wakeup lateness in microseconds
+ */
+ULONG _tx_posix_timer_ticks;
+ULONG _tx_posix_timer_late;
+ULONG _tx_posix_timer_overruns;
+ULONG _tx_posix_timer_dropped;
+ULONG _tx_posix_timer_max_late_us;
+
+/* Software interrupt thread.  Runs injected handlers through the same
+ * context_save -> handler -> context_restore path as the timer tick.
+ * The caller waits on the done pipe until its handler has run.
+ */
+pthread_t _tx_posix_swi_id;
+static tx_posix_sem_t _tx_posix_swi_semaphore;
+static VOID (*_tx_posix_swi_handler)(VOID);
+static int _tx_posix_swi_done_pipe[2];
+static void *_tx_posix_software_interrupt_thread(void *p);
+
+/* Interrupt lock.  The timer and software interrupt threads each run a
+ * whole context_save -> handler -> context_restore sequence under it, so
+ * their interrupts run one at a time, as on a single core without
+ * interrupt nesting, and never share the kernel's interrupt state.
+ */
+static pthread_mutex_t _tx_posix_isr_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /* Signal handlers. */
 static void _tx_posix_thread_resume_handler(int sig)
 {
@@ -137,6 +174,25 @@ VOID _tx_initialize_low_level(VOID)
     sp.sched_priority = TX_POSIX_PRIORITY_ISR;
     pthread_setschedparam(_tx_posix_timer_id, SCHED_FIFO, &sp);
 #endif
+
+    tx_posix_sem_init(&_tx_posix_swi_semaphore, 0);
+    if (pipe(_tx_posix_swi_done_pipe)) {
+        printf("ThreadX POSIX error creating pipes!\n");
+        while (1)
+            ;
+    }
+
+    if (pthread_create(&_tx_posix_swi_id, NULL,
+                       _tx_posix_software_interrupt_thread, NULL)) {
+        printf("ThreadX POSIX error creating software interrupt thread!\n");
+        while (1)
+            ;
+    }
+
+#ifdef __linux__
+    sp.sched_priority = TX_POSIX_PRIORITY_ISR;
+    pthread_setschedparam(_tx_posix_swi_id, SCHED_FIFO, &sp);
+#endif
 }
 
 /* _tx_initialize_start_interrupts */
@@ -146,29 +202,109 @@ void _tx_initialize_start_interrupts(void)
     tx_posix_sem_post_sched(&_tx_posix_timer_semaphore);
 }
 
-/* Timer interrupt thread (uses nanosleep -- portable) */
+/* Timer interrupt thread (absolute deadlines on CLOCK_MONOTONIC) */
+
+#define TX_POSIX_NSEC_PER_SEC 1000000000L
+
+static void _tx_posix_timespec_add(struct timespec *ts, long nsec)
+{
+    ts->tv_nsec += nsec;
+    while (ts->tv_nsec >= TX_POSIX_NSEC_PER_SEC) {
+        ts->tv_nsec -= TX_POSIX_NSEC_PER_SEC;
+        ts->tv_sec++;
+    }
+}
+
+/* a - b in nanoseconds; callers only use it for differences that fit. */
+static long long _tx_posix_timespec_diff(const struct timespec *a,
+                                         const struct timespec *b)
+{
+    return (long long) (a->tv_sec - b->tv_sec) * TX_POSIX_NSEC_PER_SEC +
+           (a->tv_nsec - b->tv_nsec);
+}
+
+/* Sleep until the absolute CLOCK_MONOTONIC time in *deadline.  macOS has
+ * no clock_nanosleep(), so convert to a relative nanosleep() there; the
+ * deadline itself still advances by exactly one period per tick, so the
+ * error does not accumulate.
+ */
+static void _tx_posix_sleep_until(const struct timespec *deadline)
+{
+#ifdef __linux__
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL) ==
+           EINTR)
+        ;
+#else
+    struct timespec now, ts;
+    long long remaining;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    remaining = _tx_posix_timespec_diff(deadline, &now);
+    if (remaining <= 0)
+        return;
+    ts.tv_sec = (time_t) (remaining / TX_POSIX_NSEC_PER_SEC);
+    ts.tv_nsec = (long) (remaining % TX_POSIX_NSEC_PER_SEC);
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+        ;
+#endif
+}
 
 static void *_tx_posix_timer_interrupt(void *p)
 {
-    struct timespec ts;
+    struct timespec deadline, now;
+    long long late;
     long nsec;
+    ULONG pending;
 
     (void) p;
-    nsec = 1000000000L / TX_TIMER_TICKS_PER_SECOND;
+    nsec = TX_POSIX_NSEC_PER_SEC / TX_TIMER_TICKS_PER_SECOND;
 
     /* Wait for the kernel to start. */
     tx_posix_sem_wait(&_tx_posix_timer_semaphore);
 
-    while (1) {
-        ts.tv_sec = 0;
-        ts.tv_nsec = nsec;
-        nanosleep(&ts, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
 
-        _tx_thread_context_save();
-        _tx_trace_isr_enter_insert(0);
-        _tx_timer_interrupt();
-        _tx_trace_isr_exit_insert(0);
-        _tx_thread_context_restore();
+    while (1) {
+        _tx_posix_timespec_add(&deadline, nsec);
+        _tx_posix_sleep_until(&deadline);
+
+        /* Account for lateness.  Every period that fully elapsed while
+         * the thread was not running is delivered as a catch-up tick so
+         * tx_thread_sleep() intervals keep wall-clock length; beyond one
+         * second of backlog, resynchronise instead of bursting.
+         */
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        late = _tx_posix_timespec_diff(&now, &deadline);
+        pending = 1;
+        if (late > 0) {
+            if (late / 1000 > (long long) _tx_posix_timer_max_late_us)
+                _tx_posix_timer_max_late_us = (ULONG) (late / 1000);
+            if (late > nsec / 4)
+                _tx_posix_timer_late++;
+            if (late >= nsec) {
+                if (late / nsec > TX_TIMER_TICKS_PER_SECOND) {
+                    _tx_posix_timer_dropped += (ULONG) (late / nsec);
+                    deadline = now;
+                } else {
+                    pending += (ULONG) (late / nsec);
+                    _tx_posix_timer_overruns += pending - 1;
+                    _tx_posix_timespec_add(&deadline,
+                                           (long) (pending - 1) * nsec);
+                }
+            }
+        }
+
+        while (pending--) {
+            _tx_posix_timer_ticks++;
+
+            pthread_mutex_lock(&_tx_posix_isr_lock);
+            _tx_thread_context_save();
+            _tx_trace_isr_enter_insert(0);
+            _tx_timer_interrupt();
+            _tx_trace_isr_exit_insert(0);
+            _tx_thread_context_restore();
+            pthread_mutex_unlock(&_tx_posix_isr_lock);
+        }
 
 #ifdef TX_LINUX_NO_IDLE_ENABLE
         tx_posix_mutex_lock(_tx_posix_mutex);
@@ -181,6 +317,61 @@ static void *_tx_posix_timer_interrupt(void *p)
     return NULL;
 }
 
+/* Software interrupt injection
+ *
+ * The host equivalent of pending an IRQ: _tx_posix_software_interrupt()
+ * hands the handler to a dedicated pthread that, exactly like the timer
+ * thread, suspends the running ThreadX thread in _tx_thread_context_save,
+ * runs the handler with _tx_thread_system_state raised, and lets
+ * _tx_thread_context_restore either resume the interrupted thread or
+ * switch to a higher-priority one the handler made ready.  No ThreadX
+ * thread is involved, so no extra thread switch is measured.
+ *
+ * The request is posted while holding _tx_posix_mutex, which
+ * context_save takes before it signals the running thread, so the
+ * caller is never suspended inside the semaphore's internal mutex; the
+ * semaphore also publishes the handler pointer.  The caller then
+ * blocks in read() on the done pipe, not on a tx_posix_sem_t: it is
+ * suspended by context_save while it waits, and a suspend landing
+ * inside that semaphore's mutex would stall the interrupt thread's
+ * post.  read() holds no user-space lock and the interrupt thread's
+ * write() never blocks.
+ */
+VOID _tx_posix_software_interrupt(VOID (*handler)(VOID))
+{
+    unsigned char byte;
+
+    tx_posix_mutex_lock(_tx_posix_mutex);
+    _tx_posix_swi_handler = handler;
+    tx_posix_sem_post(&_tx_posix_swi_semaphore);
+    tx_posix_mutex_unlock(_tx_posix_mutex);
+
+    /* Retry on EINTR -- the suspend and resume signals interrupt read(). */
+    while (read(_tx_posix_swi_done_pipe[0], &byte, 1) < 0 && errno == EINTR)
+        ;
+}
+
+static void *_tx_posix_software_interrupt_thread(void *p)
+{
+    unsigned char byte = 1;
+
+    (void) p;
+
+    while (1) {
+        tx_posix_sem_wait(&_tx_posix_swi_semaphore);
+
+        pthread_mutex_lock(&_tx_posix_isr_lock);
+        _tx_thread_context_save();
+        _tx_trace_isr_enter_insert(1);
+        _tx_posix_swi_handler();
+        _tx_trace_isr_exit_insert(1);
+        (void) write(_tx_posix_swi_done_pipe[1], &byte, 1);
+        _tx_thread_context_restore();
+        pthread_mutex_unlock(&_tx_posix_isr_lock);
+    }
+    return NULL;
+}
+
 /* Thread suspend / resume (POSIX signals -- works on macOS & Linux) */
 
 void _tx_posix_thread_suspend(pthread_t thread_id)
@@ -335,6 +335,7 @@ extern __thread int _tx_posix_threadx_thread;
 void _tx_posix_thread_suspend(pthread_t thread_id);
 void _tx_posix_thread_resume(pthread_t thread_id);
 void _tx_posix_thread_init(void);
+VOID _tx_posix_software_interrupt(VOID (*handler)(VOID));
 
 #define TX_POSIX_PRIORITY_SCHEDULE (3)
 #define TX_POSIX_PRIORITY_ISR (2)
@@ -0,0 +1,107 @@
+/*
+ * ThreadX RISC-V interrupt dispatch for Thread-Metric (QEMU virt).
+ *
+ * tm_cause_interrupt() sets the hart's CLINT MSIP bit.  The machine
+ * software interrupt traps into tm_threadx_trap_entry
+ * (tx_initialize_low_level.S), which saves the interrupted context with
+ * _tx_thread_context_save and calls tm_threadx_trap() below; that
+ * clears MSIP and calls the benchmark interrupt handlers.  If a handler
+ * wakes a higher-priority thread, _tx_thread_context_restore switches to
+ * it instead of returning -- the same ISR-to-thread preemption path a
+ * real peripheral interrupt takes.
+ *
+ * The machine timer interrupt drives the ThreadX tick: the handler moves
+ * MTIMECMP one period ahead and calls _tx_timer_interrupt().
+ *
+ * Both benchmark handlers have weak no-op defaults here.  The strong
+ * definition from whichever interrupt test is linked overrides the no-op.
+ *
+ * The CLINT has a single software interrupt per hart and no priority
+ * levels, so there are no nested interrupt sources on this target.
+ */
+
+#include <stdbool.h>
+#include "clint.h"
+#include "tm_api.h"
+
+/* ThreadX tick rate; matches TM_THREADX_TICKS_PER_SECOND in tm_port.c. */
+#define TM_THREADX_TICK_PERIOD (CLINT_MTIME_HZ / 100)
+
+#define TM_RISCV_MCAUSE_INTERRUPT (1UL << (__riscv_xlen - 1))
+#define TM_RISCV_MSTATUS_MIE 0x8UL
+
+__attribute__((weak)) void tm_interrupt_handler(void) {}
+__attribute__((weak)) void tm_interrupt_preemption_handler(void) {}
+
+extern void _tx_timer_interrupt(void);
+extern void tm_threadx_benchmark_sync_complete(void);
+
+void tm_threadx_timer_init(void);
+void tm_threadx_trap(unsigned long mcause);
+
+static volatile bool tm_benchmark_interrupt_active;
+static uint64_t tm_threadx_next_tick;
+
+/* Called last in _tx_initialize_low_level, with mstatus.MIE clear. */
+void tm_threadx_timer_init(void)
+{
+    unsigned long mie = CLINT_MIE_MTIE | CLINT_MIE_MSIE;
+
+    CLINT_MSIP = 0;
+    tm_threadx_next_tick = clint_mtime() + TM_THREADX_TICK_PERIOD;
+    clint_set_mtimecmp(tm_threadx_next_tick);
+    __asm volatile("csrs mie, %0" : : "r"(mie));
+}
+
+/* Runs between _tx_thread_context_save and _tx_thread_context_restore,
+ * on the system stack when a thread was interrupted.
+ */
+void tm_threadx_trap(unsigned long mcause)
+{
+    if (mcause == (TM_RISCV_MCAUSE_INTERRUPT | CLINT_CAUSE_MTI)) {
+        tm_threadx_next_tick += TM_THREADX_TICK_PERIOD;
+        clint_set_mtimecmp(tm_threadx_next_tick);
+        _tx_timer_interrupt();
+    } else if (mcause == (TM_RISCV_MCAUSE_INTERRUPT | CLINT_CAUSE_MSI)) {
+        CLINT_MSIP = 0;
+        tm_interrupt_handler();
+        tm_interrupt_preemption_handler();
+    } else {
+        /* Nothing in the benchmark raises an exception or an external
+         * interrupt; report instead of returning into the fault.
+         */
+        tm_check_fail("FATAL: unexpected RISC-V trap\n");
+    }
+}
+
+/* The handler clears MSIP, so waiting for it keeps the contract that
+ * the handler has run when this returns.  The trap is normally taken
+ * right after the store; the loop covers a delayed delivery.
+ */
+void tm_cause_interrupt(void)
+{
+    CLINT_MSIP = 1;
+    while (CLINT_MSIP)
+        ;
+}
+
+bool tm_benchmark_interrupt_context_active(void)
+{
+    return tm_benchmark_interrupt_active;
+}
+
+/* Synchronous variant: skip the software interrupt and run the handler
+ * in-line on the caller's stack while letting the port wrappers bracket
+ * each RTOS service with synthetic ISR context.
+ */
+void tm_cause_interrupt_sync(void)
+{
+    __asm volatile("csrc mstatus, %0" : : "r"(TM_RISCV_MSTATUS_MIE)
+                   : "memory");
+    tm_benchmark_interrupt_active = true;
+    tm_interrupt_handler();
+    tm_benchmark_interrupt_active = false;
+    __asm volatile("csrs mstatus, %0" : : "r"(TM_RISCV_MSTATUS_MIE)
+                   : "memory");
+    tm_threadx_benchmark_sync_complete();
+}
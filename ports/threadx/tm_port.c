@@ -38,8 +38,14 @@
 #include <stdint.h>
 #include <stdio.h>
 #include "tm_api.h"
+#ifndef TM_SEMIHOSTING
+#include "tm_host.h"
+#endif
 #include "tx_api.h"
 #include "tx_thread.h"
+#ifdef TM_MPU
+#include "tm_mpu.h"
+#endif
 
 
 /* Define ThreadX mapping constants. */
@@ -50,9 +56,18 @@
 #define TM_THREADX_MAX_MEMORY_POOLS 1
 
 
-/* Define the default ThreadX stack size. */
+/* Define the default ThreadX stack size.  MPU builds make each stack
+ * its own MPU region, which must be a power of two in size and aligned
+ * to it.
+ */
 
+#ifdef TM_MPU
+#define TM_THREADX_THREAD_STACK_SIZE 2048
+#define TM_THREADX_STACK_ALIGN TM_THREADX_THREAD_STACK_SIZE
+#else
 #define TM_THREADX_THREAD_STACK_SIZE 2096
+#define TM_THREADX_STACK_ALIGN sizeof(ULONG)
+#endif
 
 
 /* Define the default ThreadX queue size. */
@@ -78,12 +93,40 @@
 
 #define TM_THREADX_TICKS_PER_SECOND 100
 
-#if defined(TM_ISR_VIA_THREAD) || defined(__arm__)
+#if defined(TM_ISR_SIMULATED) || defined(__arm__) || defined(__riscv)
 extern bool tm_benchmark_interrupt_context_active(void);
 void tm_threadx_benchmark_sync_complete(void);
 
-#ifndef TM_ISR_VIA_THREAD
+#ifndef TM_ISR_SIMULATED
 static volatile bool tm_threadx_benchmark_preemption_pending;
+
+/* Mask interrupts and return the previous mask: PRIMASK on Cortex-M,
+ * the mstatus.MIE bit on RISC-V.
+ */
+static inline uint32_t tm_threadx_interrupt_save(void)
+{
+    uint32_t mask;
+#ifdef __riscv
+    unsigned long mstatus;
+
+    __asm volatile("csrrci %0, mstatus, 8" : "=r"(mstatus) : : "memory");
+    mask = (uint32_t) (mstatus & 8);
+#else
+    __asm volatile("mrs %0, primask" : "=r"(mask));
+    __asm volatile("cpsid i" ::: "memory");
+#endif
+    return mask;
+}
+
+static inline void tm_threadx_interrupt_restore(uint32_t mask)
+{
+#ifdef __riscv
+    __asm volatile("csrs mstatus, %0" : : "r"((unsigned long) mask)
+                   : "memory");
+#else
+    __asm volatile("msr primask, %0" : : "r"(mask) : "memory");
+#endif
+}
 #endif
 
 /* Save-and-restore PRIMASK rather than unconditional cpsid/cpsie:
@@ -97,8 +140,8 @@ static volatile bool tm_threadx_benchmark_preemption_pending;
  */
 static uint32_t tm_threadx_benchmark_isr_enter(void)
 {
-#ifndef TM_ISR_VIA_THREAD
-    /* Cortex-M: emulate ISR-entry preamble so any handler-driven
+#ifndef TM_ISR_SIMULATED
+    /* Cortex-M, RISC-V: emulate ISR-entry preamble so any handler-driven
      * tx_thread_resume / tx_semaphore_put defers the resulting
      * context switch until cpsie i, mirroring real ISR semantics.
      * POSIX needs no emulation -- ThreadX POSIX APIs are mutex-
@@ -106,9 +149,8 @@ static uint32_t tm_threadx_benchmark_isr_enter(void)
      * system_state without the kernel mutex races with the timer
      * thread's _tx_timer_interrupt path.
      */
-    uint32_t primask;
-    __asm volatile("mrs %0, primask" : "=r"(primask));
-    __asm volatile("cpsid i" ::: "memory");
+    uint32_t primask = tm_threadx_interrupt_save();
+
     _tx_thread_system_state++;
     _tx_thread_preempt_disable++;
     return primask;
@@ -119,7 +161,7 @@ static uint32_t tm_threadx_benchmark_isr_enter(void)
 
 static void tm_threadx_benchmark_isr_exit(uint32_t primask)
 {
-#ifndef TM_ISR_VIA_THREAD
+#ifndef TM_ISR_SIMULATED
     TX_THREAD *current_thread;
 
     _tx_thread_preempt_disable--;
@@ -131,7 +173,7 @@ static void tm_threadx_benchmark_isr_exit(uint32_t primask)
         tm_threadx_benchmark_preemption_pending = true;
     }
 
-    __asm volatile("msr primask, %0" : : "r"(primask) : "memory");
+    tm_threadx_interrupt_restore(primask);
 #else
     (void) primask;
 #endif
@@ -139,7 +181,7 @@ static void tm_threadx_benchmark_isr_exit(uint32_t primask)
 
 void tm_threadx_benchmark_sync_complete(void)
 {
-#ifndef TM_ISR_VIA_THREAD
+#ifndef TM_ISR_SIMULATED
     TX_THREAD *current_thread;
 
     if (!tm_threadx_benchmark_preemption_pending)
@@ -166,12 +208,15 @@ TX_BLOCK_POOL tm_block_pool_array[TM_THREADX_MAX_MEMORY_POOLS];
 
 /* Define ThreadX object data areas. */
 
+/* The create services set up what they use; nothing needs zeroing. */
 unsigned char
-    tm_thread_stack_area[TM_THREADX_MAX_THREADS * TM_THREADX_THREAD_STACK_SIZE];
+    tm_thread_stack_area[TM_THREADX_MAX_THREADS * TM_THREADX_THREAD_STACK_SIZE]
+    __attribute__((aligned(TM_THREADX_STACK_ALIGN))) TM_NOINIT;
 unsigned char
-    tm_queue_memory_area[TM_THREADX_MAX_QUEUES * TM_THREADX_QUEUE_SIZE];
+    tm_queue_memory_area[TM_THREADX_MAX_QUEUES * TM_THREADX_QUEUE_SIZE]
+    TM_NOINIT;
 unsigned char tm_pool_memory_area[TM_THREADX_MAX_MEMORY_POOLS *
-                                  TM_THREADX_MEMORY_POOL_SIZE];
+                                  TM_THREADX_MEMORY_POOL_SIZE] TM_NOINIT;
 
 
 /* Define array to remember the test entry function. */
@@ -189,12 +234,45 @@ void (*tm_initialization_function)(void);
 VOID tm_thread_entry(ULONG thread_input);
 
 
-/* Forward declarations for ISR simulation (POSIX host). */
-#ifdef TM_ISR_VIA_THREAD
-static TX_THREAD tm_isr_thread;
-static unsigned char tm_isr_stack[TM_THREADX_THREAD_STACK_SIZE];
-static TX_SEMAPHORE tm_isr_semaphore;
-static VOID tm_isr_thread_entry(ULONG input);
+#ifdef TM_MPU
+/* Defined in ports/threadx/cortex-m/tm_mpu.c. */
+extern void tm_threadx_mpu_init(void);
+#endif
+
+
+#ifdef TM_HOST_REALTIME
+extern pthread_t _tx_posix_timer_id;
+extern pthread_t _tx_posix_swi_id;
+
+/* Realtime mode: confirm that the SCHED_FIFO requests made by the POSIX
+ * port (scheduler, timer and software interrupt threads, and every task
+ * pthread) actually took effect.  They fail silently without
+ * CAP_SYS_NICE.
+ */
+static void tm_report_sched_policy(void)
+{
+    int i, created = 0, fifo = 0;
+    int sched_fifo = tm_host_thread_is_fifo(pthread_self());
+    int timer_fifo = tm_host_thread_is_fifo(_tx_posix_timer_id);
+    int swi_fifo = tm_host_thread_is_fifo(_tx_posix_swi_id);
+
+    for (i = 0; i < TM_THREADX_MAX_THREADS; i++) {
+        if (tm_thread_array[i].tx_thread_id == 0)
+            continue;
+        created++;
+        if (tm_host_thread_is_fifo(
+                tm_thread_array[i].tx_thread_posix_thread_id))
+            fifo++;
+    }
+
+    tm_printf("Realtime: SCHED_FIFO scheduler %s, timer %s, swi %s, "
+              "tasks %d/%d\n",
+              sched_fifo ? "yes" : "NO", timer_fifo ? "yes" : "NO",
+              swi_fifo ? "yes" : "NO", fifo, created);
+    if (fifo != created || !sched_fifo || !timer_fifo || !swi_fifo)
+        tm_printf("Realtime: WARNING: SCHED_FIFO not applied "
+                  "(run with sudo or CAP_SYS_NICE)\n");
+}
 #endif
 
 
@@ -203,21 +281,20 @@ static VOID tm_isr_thread_entry(ULONG input);
  */
 void tm_initialize(void (*test_initialization_function)(void))
 {
+#ifdef TM_MPU
+    /* Per-thread stack regions from the first context switch on. */
+    tm_threadx_mpu_init();
+#endif
+
     /* Save the test initialization function. */
     tm_initialization_function = test_initialization_function;
 
-#ifdef TM_ISR_VIA_THREAD
-    /* Create the ISR simulation thread at priority 0 (highest).  It
-     * blocks on a semaphore until tm_cause_interrupt() posts it.
-     */
-    tx_semaphore_create(&tm_isr_semaphore, "ISR trigger", 0);
-    tx_thread_create(&tm_isr_thread, "ISR", tm_isr_thread_entry, 0,
-                     tm_isr_stack, sizeof(tm_isr_stack), 0, 0, TX_NO_TIME_SLICE,
-                     TX_AUTO_START);
-#endif
-
     /* Call the previously defined initialization function. */
     (tm_initialization_function)();
+
+#ifdef TM_HOST_REALTIME
+    tm_report_sched_policy();
+#endif
 }
 
 
@@ -264,7 +341,7 @@ int tm_thread_resume(int thread_id)
     if (thread_id < 0 || thread_id >= TM_THREADX_MAX_THREADS)
         return TM_ERROR;
 
-#if defined(TM_ISR_VIA_THREAD) || defined(__arm__)
+#if defined(TM_ISR_SIMULATED) || defined(__arm__) || defined(__riscv)
     if (tm_benchmark_interrupt_context_active()) {
         uint32_t primask = tm_threadx_benchmark_isr_enter();
         status = tx_thread_resume(&tm_thread_array[thread_id]);
@@ -315,17 +392,100 @@ void tm_thread_relinquish(void)
 }
 
 
+/* These functions bracket a short critical section by masking
+ * interrupts, which also holds off preemption.
+ */
+static UINT tm_critical_posture;
+
+void tm_critical_enter(void)
+{
+    tm_critical_posture = tx_interrupt_control(TX_INT_DISABLE);
+}
+
+void tm_critical_exit(void)
+{
+    tx_interrupt_control(tm_critical_posture);
+}
+
+
 /* This function suspends the specified thread for the specified number
  * of seconds.  If successful, the function should return TM_SUCCESS.
  * Otherwise, TM_ERROR should be returned.
  */
 void tm_thread_sleep(int seconds)
 {
+#ifdef TM_VIRTUAL_TIME
+    unsigned long long deadline;
+
+    /* Virtual time: sleep one tick at a time until the instruction
+     * budget is spent, so the interval is independent of host speed.
+     */
+    if (tm_vtime_active()) {
+        deadline = tm_vtime_deadline(seconds);
+        while (!tm_vtime_expired(deadline))
+            tx_thread_sleep(1);
+        return;
+    }
+#endif
+
     /* Attempt to sleep. */
     tx_thread_sleep(((UINT) seconds) * TM_THREADX_TICKS_PER_SECOND);
 }
 
 
+/* This function reports the peak stack usage of the specified thread.
+ * tx_thread_create() fills each stack with TX_STACK_FILL; the deepest
+ * word no longer holding it marks the peak.  With TX_ENABLE_STACK_CHECKING
+ * the kernel already tracks that word at every context switch.  The
+ * POSIX port runs threads on pthread stacks, so only the semihosting
+ * targets can measure.  If successful, the function should return
+ * TM_SUCCESS. Otherwise, TM_ERROR should be returned.
+ */
+int tm_thread_stack_usage(int thread_id,
+                          unsigned long *used,
+                          unsigned long *size)
+{
+#if defined(TM_SEMIHOSTING) && !defined(TX_DISABLE_STACK_FILLING)
+    TX_THREAD *thread;
+    unsigned char *end, *peak;
+
+    if (thread_id < 0 || thread_id >= TM_THREADX_MAX_THREADS)
+        return TM_ERROR;
+    thread = &tm_thread_array[thread_id];
+    if (thread->tx_thread_id != TX_THREAD_ID)
+        return TM_ERROR;
+
+    end = (unsigned char *) thread->tx_thread_stack_end + 1;
+#ifdef TX_ENABLE_STACK_CHECKING
+    peak = (unsigned char *) thread->tx_thread_stack_highest_ptr;
+#else
+    {
+        ULONG *p = (ULONG *) thread->tx_thread_stack_start;
+
+#ifdef TM_MPU
+        /* Skip the guard: no-access for the running thread, and a
+         * stack that reached it has already faulted.
+         */
+        p += TM_MPU_GUARD_SIZE / sizeof(ULONG);
+#endif
+        while ((unsigned char *) p < end && *p == TX_STACK_FILL)
+            p++;
+        peak = (unsigned char *) p;
+    }
+#endif
+
+    *used = (unsigned long) (end - peak);
+    *size = (unsigned long) thread->tx_thread_stack_size;
+    return TM_SUCCESS;
+#else
+    (void) thread_id;
+    (void) used;
+    (void) size;
+    return TM_ERROR;
+#endif
+}
+
+
 /* This function creates the specified queue.  If successful, the function
  * should return TM_SUCCESS. Otherwise, TM_ERROR should be returned.
  */
@@ -364,8 +524,19 @@ int tm_queue_send(int queue_id, unsigned long *message_ptr)
     if (queue_id < 0 || queue_id >= TM_THREADX_MAX_QUEUES)
         return TM_ERROR;
 
+#if defined(TM_ISR_SIMULATED) || defined(__arm__) || defined(__riscv)
+    if (tm_benchmark_interrupt_context_active()) {
+        uint32_t primask = tm_threadx_benchmark_isr_enter();
+        status =
+            tx_queue_send(&tm_queue_array[queue_id], message_ptr, TX_NO_WAIT);
+        tm_threadx_benchmark_isr_exit(primask);
+    } else
+#endif
     /* Send the message to the specified queue. */
-    status = tx_queue_send(&tm_queue_array[queue_id], message_ptr, TX_NO_WAIT);
+    {
+        status =
+            tx_queue_send(&tm_queue_array[queue_id], message_ptr, TX_NO_WAIT);
+    }
 
     /* Determine if the queue send was successful. */
     if (status == TX_SUCCESS)
@@ -451,7 +622,7 @@ int tm_semaphore_put(int semaphore_id)
     if (semaphore_id < 0 || semaphore_id >= TM_THREADX_MAX_SEMAPHORES)
         return TM_ERROR;
 
-#if defined(TM_ISR_VIA_THREAD) || defined(__arm__)
+#if defined(TM_ISR_SIMULATED) || defined(__arm__) || defined(__riscv)
     if (tm_benchmark_interrupt_context_active()) {
         uint32_t primask = tm_threadx_benchmark_isr_enter();
         status = tx_semaphore_put(&tm_semaphore_array[semaphore_id]);
@@ -552,6 +723,11 @@ VOID tm_thread_entry(ULONG thread_input)
     /* Pickup the entry function from the saved array. */
     entry_function = (void (*)(void)) tm_thread_entry_functions[thread_input];
 
+#ifdef TM_BOOT_TIME
+    /* The first thread to get here ends the boot-time measurement. */
+    tm_report_boot_mark();
+#endif
+
     /* Call the entry function. */
     (entry_function)();
 }
@@ -559,37 +735,33 @@ VOID tm_thread_entry(ULONG thread_input)
 
 /* ISR simulation for POSIX host
  *
- * When TM_ISR_VIA_THREAD is defined (via -D in the Makefile for posix-host),
- * interrupts are simulated with a priority-0 thread woken by semaphore.
- * tx_semaphore_put() from the test thread triggers immediate preemption
- * to the ISR thread; after the handler returns, the ISR thread suspends
- * and the caller resumes -- identical to a synchronous hardware trap.
+ * When TM_ISR_SIMULATED is defined (via -D in the Makefile for posix-host),
+ * tm_cause_interrupt() injects a software interrupt into the simulator
+ * (ports/threadx/posix-host/tx_initialize_low_level.c).  The handlers run
+ * on the simulator's interrupt pthread between _tx_thread_context_save()
+ * and _tx_thread_context_restore() -- the same path as the timer tick --
+ * so a handler-driven resume preempts on interrupt exit, as on Cortex-M.
  *
  * Both handlers have weak defaults here.  The strong definition from
  * whichever interrupt test is linked overrides the no-op.
  */
 
-#ifdef TM_ISR_VIA_THREAD
+#ifdef TM_ISR_SIMULATED
 
 __attribute__((weak)) void tm_interrupt_handler(void) {}
 __attribute__((weak)) void tm_interrupt_preemption_handler(void) {}
 
 static volatile bool tm_benchmark_interrupt_active;
 
-static VOID tm_isr_thread_entry(ULONG input)
+static VOID tm_isr_dispatch(VOID)
 {
-    (void) input;
-
-    while (1) {
-        tx_semaphore_get(&tm_isr_semaphore, TX_WAIT_FOREVER);
-        tm_interrupt_handler();
-        tm_interrupt_preemption_handler();
-    }
+    tm_interrupt_handler();
+    tm_interrupt_preemption_handler();
 }
 
 void tm_cause_interrupt(void)
 {
-    tx_semaphore_put(&tm_isr_semaphore);
+    _tx_posix_software_interrupt(tm_isr_dispatch);
 }
 
 bool tm_benchmark_interrupt_context_active(void)
@@ -597,9 +769,9 @@ bool tm_benchmark_interrupt_context_active(void)
     return tm_benchmark_interrupt_active;
 }
 
-/* Synchronous variant: skip the ISR-thread round-trip and run the
- * handler in-line on the caller's stack while the port wrappers bracket
- * each RTOS service with synthetic ISR context.
+/* Synchronous variant: skip the software-interrupt round-trip and run
+ * the handler in-line on the caller's stack while the port wrappers
+ * bracket each RTOS service with synthetic ISR context.
  */
 void tm_cause_interrupt_sync(void)
 {
@@ -608,11 +780,65 @@ void tm_cause_interrupt_sync(void)
     tm_benchmark_interrupt_active = false;
 }
 
-#endif /* TM_ISR_VIA_THREAD */
+#endif /* TM_ISR_SIMULATED */
+
+
+/* Kernel view of interrupt context, for tests that check ISR bookkeeping.
+ * The Cortex-M port folds IPSR into TX_THREAD_GET_SYSTEM_STATE(); the
+ * RISC-V port and the POSIX simulator count _tx_thread_system_state in
+ * context save/restore.
+ */
+int tm_isr_context(void)
+{
+    return TX_THREAD_GET_SYSTEM_STATE() != 0;
+}
+
+
+/* TrustZone builds: give the calling thread a secure stack in the
+ * secure image, which the cortex_m33 port's PendSV saves and restores
+ * on every switch of this thread.
+ */
+#ifdef TM_TRUSTZONE
+#define TM_THREADX_SECURE_STACK_SIZE 256
+
+int tm_secure_context_allocate(void)
+{
+    UINT status;
+
+    status = tx_thread_secure_stack_allocate(tx_thread_identify(),
+                                             TM_THREADX_SECURE_STACK_SIZE);
+    return status == TX_SUCCESS ? TM_SUCCESS : TM_ERROR;
+}
+#endif
+
+
+/* Running statistics for the POSIX host timer thread
+ * (ports/threadx/posix-host/tx_initialize_low_level.c).  Late or missed
+ * ticks stretch every tx_thread_sleep(), so a noisy host shows up here
+ * rather than silently inflating the reporting interval.
+ */
+#ifndef TM_SEMIHOSTING
+extern ULONG _tx_posix_timer_ticks;
+extern ULONG _tx_posix_timer_late;
+extern ULONG _tx_posix_timer_overruns;
+extern ULONG _tx_posix_timer_dropped;
+extern ULONG _tx_posix_timer_max_late_us;
+
+void tm_port_report(void)
+{
+    tm_printf("Timer ticks: %lu, late: %lu, overruns: %lu, dropped: %lu, "
+              "max late: %lu us\n",
+              (unsigned long) _tx_posix_timer_ticks,
+              (unsigned long) _tx_posix_timer_late,
+              (unsigned long) _tx_posix_timer_overruns,
+              (unsigned long) _tx_posix_timer_dropped,
+              (unsigned long) _tx_posix_timer_max_late_us);
+}
+#endif
 
 
 /* Low-level character output for tm_printf().
- * Cortex-M semihosting builds use ports/common/cortex-m/tm_putchar.c instead.
+ * QEMU semihosting builds use ports/common/<arch>/tm_putchar.c instead.
  */
 #ifndef TM_SEMIHOSTING
 void tm_putchar(int c)
@@ -0,0 +1,155 @@
+# Shared part of the Cortex-M A/B comparison scripts (mpu-compare.sh,
+# ramfunc-compare.sh); source it, do not run it.
+#
+# A script sets DEFAULT_TESTS, defines measure() and calls, in order:
+#
+#   compare_setup "$@"            -- parse "<threadx|freertos> [test...]",
+#                                    save .config, cd to the top level
+#   compare_variant <name> <defconfig> [make goal...]
+#                                 -- build each test from <defconfig> and
+#                                    record "<name> <test> <value>"
+#   compare_table <title> <name> <heading> <name> <heading>
+#                                 -- print the two variants side by side
+#                                    with the relative change
+#
+# measure <elf> runs one test binary and prints the figure to compare
+# (or nothing).  compare_tmpfile <var> sets <var> to a scratch file
+# that is removed on exit.  The current .config is restored on exit;
+# build/ is left holding the last variant.
+#
+# Environment:
+#   BOARD            -- an385 (Cortex-M3, default) or an386 (Cortex-M4F)
+#   TM_TEST_DURATION -- reporting interval in virtual seconds (default: 5)
+#   QEMU_ICOUNT      -- instruction-count shift (default: 5)
+#   QEMU             -- path to qemu-system-arm (default: qemu-system-arm)
+
+set -euo pipefail
+
+compare_saved_config=""
+compare_results=""
+compare_tmpfiles=()
+
+compare_cleanup()
+{
+    if [ -n "$compare_saved_config" ]; then
+        mv -f "$compare_saved_config" .config
+    fi
+    [ -z "$compare_results" ] || rm -f "$compare_results"
+    if [ ${#compare_tmpfiles[@]} -gt 0 ]; then
+        rm -f "${compare_tmpfiles[@]}"
+    fi
+}
+
+# Set the variable named $1 to a new scratch file, removed on exit.
+compare_tmpfile()
+{
+    local f
+
+    f=$(mktemp "${TMPDIR:-/tmp}/tm-compare.XXXXXX")
+    compare_tmpfiles+=("$f")
+    printf -v "$1" '%s' "$f"
+}
+
+compare_setup()
+{
+    if [ $# -lt 1 ]; then
+        echo "Usage: $0 <threadx|freertos> [test...]" >&2
+        exit 1
+    fi
+
+    RTOS="$1"
+    shift
+    case "$RTOS" in
+        threadx | freertos) ;;
+        *)
+            echo "Error: unknown RTOS: $RTOS" >&2
+            exit 1
+            ;;
+    esac
+
+    if [ $# -gt 0 ]; then
+        TESTS=("$@")
+    else
+        TESTS=("${DEFAULT_TESTS[@]}")
+    fi
+
+    DURATION="${TM_TEST_DURATION:-5}"
+    SHIFT="${QEMU_ICOUNT:-5}"
+    QEMU="${QEMU:-qemu-system-arm}"
+
+    # Board overrides for make, scripts/qemu-run.sh and the tm_cycles
+    # cost model; the defconfigs are for mps2-an385.
+    case "${BOARD:-an385}" in
+        an385)
+            BOARD_ARGS=()
+            BOARD_CPU=m3
+            export QEMU_MACHINE=mps2-an385 QEMU_CPU=cortex-m3
+            ;;
+        an386)
+            BOARD_ARGS=(CONFIG_CORTEX_M_AN386=y)
+            BOARD_CPU=m4
+            export QEMU_MACHINE=mps2-an386 QEMU_CPU=cortex-m4
+            ;;
+        *)
+            echo "Error: unknown BOARD: $BOARD (an385 or an386)" >&2
+            exit 1
+            ;;
+    esac
+
+    cd "$(dirname "$0")/.."
+
+    trap compare_cleanup EXIT
+    trap 'trap - EXIT; compare_cleanup; exit 130' INT
+    trap 'trap - EXIT; compare_cleanup; exit 143' TERM
+
+    if [ -f .config ]; then
+        compare_saved_config=$(mktemp "${TMPDIR:-/tmp}/tm-config.XXXXXX")
+        cp .config "$compare_saved_config"
+    fi
+    compare_results=$(mktemp "${TMPDIR:-/tmp}/tm-compare.XXXXXX")
+}
+
+compare_variant()
+{
+    local variant="$1" defconfig="$2" t elf value
+    shift 2
+
+    echo "  CONFIG  $defconfig"
+    make --quiet "$defconfig" > /dev/null
+    make --quiet clean-build
+    if [ $# -gt 0 ]; then
+        make --quiet "$@" ${BOARD_ARGS[@]+"${BOARD_ARGS[@]}"}
+    fi
+    for t in "${TESTS[@]}"; do
+        elf="build/tm_$t"
+        make --quiet "$elf" CONFIG_QEMU_ICOUNT=y \
+            CONFIG_QEMU_ICOUNT_SHIFT="$SHIFT" \
+            TM_TEST_DURATION="$DURATION" TM_TEST_CYCLES=1 \
+            ${BOARD_ARGS[@]+"${BOARD_ARGS[@]}"}
+        printf "  RUN     %s\n" "$t"
+        value=$(measure "$elf")
+        echo "$variant $t ${value:--}" >> "$compare_results"
+    done
+}
+
+compare_table()
+{
+    local title="$1" a="$2" a_head="$3" b="$4" b_head="$5"
+
+    echo ""
+    echo "$title"
+    awk -v a="$a" -v b="$b" -v ah="$a_head" -v bh="$b_head" '
+        $1 == a { va[$2] = $3; order[++n] = $2 }
+        $1 == b { vb[$2] = $3 }
+        END {
+            printf "  %-36s %12s %12s %8s\n", "test", ah, bh, "change"
+            for (i = 1; i <= n; i++) {
+                t = order[i]
+                if (va[t] == "-" || vb[t] == "-" || va[t] == 0)
+                    change = "n/a"
+                else
+                    change = sprintf("%+.1f%%", (vb[t] - va[t]) * 100 / va[t])
+                printf "  %-36s %12s %12s %8s\n", t, va[t], vb[t], change
+            }
+        }' "$compare_results"
+}
@@ -0,0 +1,214 @@
+#!/usr/bin/env bash
+# Static memory footprint of Thread-Metric test binaries.
+#
+# Usage:
+#   scripts/footprint.sh <elf>...
+#
+# Splits the flash and RAM of each test binary between the benchmark
+# harness, the porting layer, the RTOS kernel and the port's data areas,
+# and prints one row per test and memory.  "make footprint" supplies the
+# object lists below and writes the table to build/footprint.txt; keep a
+# copy and pass it back as FOOTPRINT_BASELINE to see what a later commit
+# changed.
+#
+# An allocated section counts towards flash when the image carries its
+# contents, and towards RAM when it is writable or copied there at boot
+# (.data, .ramfunc).  Each sized symbol then goes to the first group that
+# claims its name:
+#
+#   port data -- the port's static thread stacks, queue and pool areas
+#                and the FreeRTOS heap (ucHeap, configTOTAL_HEAP_SIZE)
+#   port      -- symbols defined by the FOOTPRINT_PORT objects
+#   harness   -- symbols defined by the test's own object or by the
+#                FOOTPRINT_HARNESS objects
+#   kernel    -- symbols defined by the FOOTPRINT_KERNEL library
+#   other     -- the rest of the section sizes: C library, stack and heap
+#                reservations, alignment padding
+#
+# Environment:
+#   FOOTPRINT_KERNEL   -- RTOS library archive
+#   FOOTPRINT_PORT     -- porting-layer objects, space separated
+#   FOOTPRINT_HARNESS  -- shared harness objects, space separated
+#   FOOTPRINT_TESTS    -- directory holding <test>.c.o for each tm_<test>
+#   FOOTPRINT_LABEL    -- configuration named in the table header
+#   FOOTPRINT_BASELINE -- earlier table; adds the change in each total
+#   NM                 -- nm for the target (default: nm)
+#   OBJDUMP            -- objdump for the target (default: objdump)
+
+set -euo pipefail
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <elf>..." >&2
+    exit 1
+fi
+
+NM="${NM:-nm}"
+OBJDUMP="${OBJDUMP:-objdump}"
+BASELINE="${FOOTPRINT_BASELINE:-}"
+
+if [ -n "$BASELINE" ] && [ ! -f "$BASELINE" ]; then
+    echo "Error: baseline not found: $BASELINE" >&2
+    exit 1
+fi
+
+shared=""
+kernel=""
+rows=""
+
+cleanup()
+{
+    [ -z "$shared" ] || rm -f "$shared"
+    [ -z "$kernel" ] || rm -f "$kernel"
+    [ -z "$rows" ] || rm -f "$rows"
+}
+trap cleanup EXIT
+
+shared=$(mktemp "${TMPDIR:-/tmp}/tm-footprint.XXXXXX")
+kernel=$(mktemp "${TMPDIR:-/tmp}/tm-footprint.XXXXXX")
+rows=$(mktemp "${TMPDIR:-/tmp}/tm-footprint.XXXXXX")
+
+# Print "G <group> <symbol>" for every symbol the given objects define.
+symbols_of()
+{
+    local group="$1"
+    shift
+    [ $# -gt 0 ] || return 0
+    "$NM" --defined-only "$@" 2> /dev/null |
+        awk -v g="$group" 'NF == 3 { print "G", g, $3 }'
+}
+
+# Earlier groups win: port, harness, the test's own object, kernel.
+# shellcheck disable=SC2086
+{
+    symbols_of port ${FOOTPRINT_PORT:-}
+    symbols_of harness ${FOOTPRINT_HARNESS:-}
+} > "$shared"
+if [ -n "${FOOTPRINT_KERNEL:-}" ]; then
+    symbols_of kernel "$FOOTPRINT_KERNEL" > "$kernel"
+fi
+
+for elf in "$@"; do
+    t=$(basename "$elf")
+    t=${t#tm_}
+    {
+        cat "$shared"
+        if [ -n "${FOOTPRINT_TESTS:-}" ]; then
+            symbols_of harness "$FOOTPRINT_TESTS/$t.c.o"
+        fi
+        cat "$kernel"
+        # "S <name> <size> <vma> <lma> <flags...>", flags from the
+        # line under each section header.
+        "$OBJDUMP" -h "$elf" | awk '
+            $1 ~ /^[0-9]+$/ { s = "S " $2 " " $3 " " $4 " " $5; next }
+            s != "" { print s, $0; s = "" }'
+        "$NM" -S --defined-only -f sysv "$elf" | sed 's/^/Y|/'
+    } | awk -v t="$t" '
+        function hex(s,    i, n)
+        {
+            n = 0
+            s = tolower(s)
+            for (i = 1; i <= length(s); i++)
+                n = n * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+            return n
+        }
+        function trim(s)
+        {
+            gsub(/^[ \t]+|[ \t]+$/, "", s)
+            return s
+        }
+        BEGIN {
+            # Port data areas, by the names the ports give them.
+            split("tm_thread_stack_area tm_queue_memory_area " \
+                  "tm_pool_memory_area tm_thread_stacks tm_pool_area " \
+                  "ucHeap", names, " ")
+            for (i in names)
+                group[names[i]] = "data"
+        }
+        $1 == "G" {
+            if (!($3 in group))
+                group[$3] = $2
+            next
+        }
+        $1 == "S" {
+            if ($0 !~ /ALLOC/)
+                next
+            size = hex($3)
+            if ($0 ~ /LOAD/) {
+                flash[$2] = 1
+                total["flash"] += size
+            }
+            if ($0 !~ /READONLY/ || $4 != $5) {
+                ram[$2] = 1
+                total["RAM"] += size
+            }
+            next
+        }
+        substr($0, 1, 2) == "Y|" {
+            # Y|name|value|class|type|size|line|section
+            n = split($0, f, "|")
+            if (n < 8)
+                next
+            name = trim(f[2])
+            size = trim(f[6])
+            sec = trim(f[8])
+            if (size == "" || hex(size) == 0)
+                next
+            # Aliases (weak handlers and the like) share one definition.
+            key = sec ":" trim(f[3])
+            if (key in seen)
+                next
+            seen[key] = 1
+            g = (name in group) ? group[name] : "other"
+            if (sec in flash)
+                used[g, "flash"] += hex(size)
+            if (sec in ram)
+                used[g, "RAM"] += hex(size)
+        }
+        END {
+            split("flash RAM", mems, " ")
+            for (m = 1; m <= 2; m++) {
+                mem = mems[m]
+                known = used["harness", mem] + used["port", mem] + \
+                        used["kernel", mem] + used["data", mem]
+                printf "%s %s %d %d %d %d %d %d\n", t, mem,
+                       used["harness", mem], used["port", mem],
+                       used["kernel", mem], used["data", mem],
+                       total[mem] - known, total[mem]
+            }
+        }' >> "$rows"
+done
+
+top="$(dirname "$0")/.."
+if rev=$(git -C "$top" rev-parse --short HEAD 2> /dev/null); then
+    git -C "$top" diff --quiet HEAD 2> /dev/null || rev="$rev-dirty"
+else
+    rev=unknown
+fi
+
+echo "# Thread-Metric static footprint in bytes, ${FOOTPRINT_LABEL:-unknown}" \
+    "at $rev"
+awk -v baseline="$BASELINE" '
+    BEGIN {
+        if (baseline != "")
+            while ((getline line < baseline) > 0) {
+                if (line ~ /^#/)
+                    continue
+                n = split(line, f, " ")
+                if (n >= 8 && (f[2] == "flash" || f[2] == "RAM"))
+                    base[f[1], f[2]] = f[8]
+            }
+        printf "%-34s %-5s %8s %8s %8s %9s %8s %8s", "test", "mem",
+               "harness", "port", "kernel", "port-data", "other", "total"
+        printf "%s\n", baseline != "" ? sprintf(" %8s", "change") : ""
+    }
+    {
+        printf "%-34s %-5s %8d %8d %8d %9d %8d %8d", $1, $2, $3, $4, $5,
+               $6, $7, $8
+        if (baseline == "")
+            change = ""
+        else if (($1, $2) in base)
+            change = sprintf(" %+8d", $8 - base[$1, $2])
+        else
+            change = sprintf(" %8s", "new")
+        printf "%s\n", change
+    }' "$rows"
@@ -0,0 +1,39 @@
+#!/usr/bin/env bash
+# Report the cost of MPU-protected threads on Cortex-M (mps2-an385).
+#
+# Usage:
+#   scripts/mpu-compare.sh <threadx|freertos> [test...]
+#
+# Builds <rtos>_cortex_m_defconfig and <rtos>_cortex_m_mpu_defconfig in
+# turn, both in deterministic instruction-count mode (CONFIG_QEMU_ICOUNT),
+# runs each test for one reporting interval under QEMU and prints the
+# operations per million instructions of the two builds side by side
+# with the relative change.  Without test arguments it runs the
+# scheduling and interrupt tests, where every operation involves a
+# context switch and so an MPU reprogramming.
+#
+# The current .config is restored on exit; build/ is rebuilt for each
+# configuration and left holding the MPU build.
+#
+# Environment: BOARD, TM_TEST_DURATION, QEMU_ICOUNT and QEMU, as
+# described in scripts/compare-lib.sh.
+
+DEFAULT_TESTS=(cooperative_scheduling preemptive_scheduling
+    interrupt_processing interrupt_preemption_processing)
+
+# shellcheck source=scripts/compare-lib.sh
+. "$(dirname "$0")/compare-lib.sh"
+
+# Operations per million instructions of one run.
+measure()
+{
+    QEMU="$QEMU" QEMU_ICOUNT="$SHIFT" scripts/qemu-run.sh "$1" \
+        -semihosting-config enable=on,target=native 2>&1 |
+        awk '/Ops per million instructions:/ { v = $NF } END { print v }'
+}
+
+compare_setup "$@"
+compare_variant plain "${RTOS}_cortex_m_defconfig"
+compare_variant mpu "${RTOS}_cortex_m_mpu_defconfig"
+compare_table "MPU overhead, $RTOS on $QEMU_MACHINE \
+(ops per million instructions)" plain unprotected mpu MPU
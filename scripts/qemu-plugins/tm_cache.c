@@ -0,0 +1,308 @@
+/*
+ * QEMU TCG plugin: modelled I-cache and D-cache misses per function.
+ *
+ * Runs every instruction fetch and data access of the guest through a
+ * set-associative, LRU, write-allocate cache model with a Cortex-M7-like
+ * default geometry (16 KB 2-way I-cache, 16 KB 4-way D-cache, 32-byte
+ * lines).  At exit it writes the overall miss rates and, per function,
+ * instruction-fetch misses, data accesses and data misses, sorted by
+ * total misses.  Functions at the top are the candidates for TCM.
+ *
+ * Arguments:
+ *   syms=<file>     symbol map from "nm -S -n --defined-only <elf>"
+ *   out=<file>      write the report here instead of QEMU's log
+ *   icache=<bytes>  I-cache size (default 16384; 0 disables)
+ *   iassoc=<ways>   I-cache associativity (default 2)
+ *   dcache=<bytes>  D-cache size (default 16384; 0 disables)
+ *   dassoc=<ways>   D-cache associativity (default 4)
+ *   line=<bytes>    line size of both caches (default 32)
+ *   top=<n>         functions to list (default 25)
+ *
+ * Fetches are modelled per translation block: each cache line the block
+ * covers is looked up once per execution.  Accesses at or above
+ * 0x40000000 (peripherals, device memory) bypass the D-cache.
+ */
+
+#include "tm_plugin.h"
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+#define TM_DEVICE_BASE 0x40000000ULL
+
+struct tm_cache {
+    uint64_t *tags;  /* line address per way, ~0 when invalid */
+    uint64_t *stamp; /* last use, for LRU */
+    unsigned int sets;
+    unsigned int assoc;
+    uint64_t accesses;
+    uint64_t misses;
+};
+
+/* Per-symbol counters; index tm_nsyms collects addresses with no symbol. */
+struct tm_func {
+    uint64_t imisses;
+    uint64_t daccesses;
+    uint64_t dmisses;
+};
+
+/* One cache line of a translation block and the function fetching it. */
+struct tm_fetch {
+    uint64_t line;
+    int func;
+};
+
+struct tm_block {
+    int nlines;
+    struct tm_fetch lines[];
+};
+
+static struct tm_cache tm_icache, tm_dcache;
+static struct tm_func *tm_funcs;
+static unsigned int tm_line_shift = 5;
+static uint64_t tm_clock;
+static int tm_top = 25;
+
+static int tm_cache_init(struct tm_cache *cache, unsigned long size,
+                         unsigned long assoc, unsigned long line)
+{
+    unsigned long lines, i;
+
+    if (size == 0)
+        return 0;
+    lines = size / line;
+    if (assoc == 0 || lines < assoc || lines % assoc ||
+        ((lines / assoc) & (lines / assoc - 1)))
+        return -1;
+    cache->sets = lines / assoc;
+    cache->assoc = assoc;
+    cache->tags = malloc(lines * sizeof(*cache->tags));
+    cache->stamp = calloc(lines, sizeof(*cache->stamp));
+    if (!cache->tags || !cache->stamp)
+        return -1;
+    for (i = 0; i < lines; i++)
+        cache->tags[i] = ~(uint64_t) 0;
+    return 0;
+}
+
+/* Look up line (an address already shifted by the line size); returns 1
+ * on a miss, after filling the least recently used way.
+ */
+static int tm_cache_access(struct tm_cache *cache, uint64_t line)
+{
+    uint64_t *tags, *stamp;
+    unsigned int way, victim = 0;
+
+    if (!cache->tags)
+        return 0;
+    tags = &cache->tags[(line & (cache->sets - 1)) * cache->assoc];
+    stamp = &cache->stamp[(line & (cache->sets - 1)) * cache->assoc];
+    cache->accesses++;
+    tm_clock++;
+
+    for (way = 0; way < cache->assoc; way++) {
+        if (tags[way] == line) {
+            stamp[way] = tm_clock;
+            return 0;
+        }
+        if (stamp[way] < stamp[victim])
+            victim = way;
+    }
+    cache->misses++;
+    tags[victim] = line;
+    stamp[victim] = tm_clock;
+    return 1;
+}
+
+static void tm_vcpu_tb_exec(unsigned int vcpu_index, void *udata)
+{
+    struct tm_block *block = udata;
+    int i;
+
+    (void) vcpu_index;
+    for (i = 0; i < block->nlines; i++)
+        if (tm_cache_access(&tm_icache, block->lines[i].line))
+            tm_funcs[block->lines[i].func].imisses++;
+}
+
+static void tm_vcpu_mem(unsigned int vcpu_index, qemu_plugin_meminfo_t info,
+                        uint64_t vaddr, void *udata)
+{
+    struct tm_func *fn = &tm_funcs[(intptr_t) udata];
+
+    (void) vcpu_index;
+    (void) info;
+    if (vaddr >= TM_DEVICE_BASE || !tm_dcache.tags)
+        return;
+    fn->daccesses++;
+    if (tm_cache_access(&tm_dcache, vaddr >> tm_line_shift))
+        fn->dmisses++;
+}
+
+static void tm_vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    size_t n = qemu_plugin_tb_n_insns(tb), i;
+    struct tm_block *block;
+
+    (void) id;
+    /* An instruction spans at most two lines. */
+    block = malloc(sizeof(*block) + 2 * n * sizeof(block->lines[0]));
+    if (!block)
+        return;
+    block->nlines = 0;
+
+    for (i = 0; i < n; i++) {
+        struct qemu_plugin_insn *insn = qemu_plugin_tb_get_insn(tb, i);
+        uint64_t vaddr = qemu_plugin_insn_vaddr(insn);
+        uint64_t line = vaddr >> tm_line_shift;
+        uint64_t last = (vaddr + qemu_plugin_insn_size(insn) - 1) >>
+                        tm_line_shift;
+        int func = tm_syms_find(vaddr);
+
+        if (func < 0)
+            func = tm_nsyms;
+        for (; line <= last; line++) {
+            if (block->nlines &&
+                block->lines[block->nlines - 1].line == line)
+                continue;
+            block->lines[block->nlines].line = line;
+            block->lines[block->nlines].func = func;
+            block->nlines++;
+        }
+
+        qemu_plugin_register_vcpu_mem_cb(insn, tm_vcpu_mem,
+                                         QEMU_PLUGIN_CB_NO_REGS,
+                                         QEMU_PLUGIN_MEM_RW,
+                                         (void *) (intptr_t) func);
+    }
+
+    qemu_plugin_register_vcpu_tb_exec_cb(tb, tm_vcpu_tb_exec,
+                                         QEMU_PLUGIN_CB_NO_REGS, block);
+}
+
+static uint64_t tm_func_misses(int i)
+{
+    return tm_funcs[i].imisses + tm_funcs[i].dmisses;
+}
+
+static int tm_func_cmp_misses(const void *a, const void *b)
+{
+    uint64_t ma = tm_func_misses(*(const int *) a);
+    uint64_t mb = tm_func_misses(*(const int *) b);
+
+    if (ma != mb)
+        return ma > mb ? -1 : 1;
+    return 0;
+}
+
+static void tm_cache_report(const char *name, const struct tm_cache *cache)
+{
+    if (!cache->tags) {
+        tm_out_printf("# %s: disabled\n", name);
+        return;
+    }
+    tm_out_printf("# %s: %u KB %u-way, %" PRIu64 " accesses, %" PRIu64
+                  " misses, miss rate %.3f%%\n",
+                  name,
+                  (cache->sets * cache->assoc << tm_line_shift) / 1024,
+                  cache->assoc, cache->accesses, cache->misses,
+                  cache->accesses ? 100.0 * cache->misses / cache->accesses
+                                  : 0.0);
+}
+
+static void tm_plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    int *sorted;
+    int i;
+
+    (void) id;
+    (void) p;
+
+    tm_cache_report("I-cache", &tm_icache);
+    tm_cache_report("D-cache", &tm_dcache);
+
+    sorted = malloc((tm_nsyms + 1) * sizeof(*sorted));
+    if (sorted) {
+        for (i = 0; i <= tm_nsyms; i++)
+            sorted[i] = i;
+        qsort(sorted, tm_nsyms + 1, sizeof(*sorted), tm_func_cmp_misses);
+
+        tm_out_printf("# %-38s %12s %14s %12s %8s\n", "function",
+                      "I misses", "D accesses", "D misses", "D miss%");
+        for (i = 0; i <= tm_nsyms && i < tm_top; i++) {
+            struct tm_func *fn = &tm_funcs[sorted[i]];
+
+            if (!tm_func_misses(sorted[i]))
+                break;
+            tm_out_printf("  %-38s %12" PRIu64 " %14" PRIu64 " %12" PRIu64
+                          " %8.2f\n",
+                          sorted[i] < tm_nsyms ? tm_syms[sorted[i]].name
+                                               : "(no symbol)",
+                          fn->imisses, fn->daccesses, fn->dmisses,
+                          fn->daccesses ? 100.0 * fn->dmisses / fn->daccesses
+                                        : 0.0);
+        }
+        free(sorted);
+    }
+    tm_out_close();
+}
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_install(qemu_plugin_id_t id,
+                                           const qemu_info_t *info,
+                                           int argc, char **argv)
+{
+    const char *syms = NULL, *out = NULL;
+    unsigned long isize = 16384, iassoc = 2, dsize = 16384, dassoc = 4;
+    unsigned long line = 32;
+    int i;
+
+    (void) info;
+    for (i = 0; i < argc; i++) {
+        if (strncmp(argv[i], "syms=", 5) == 0)
+            syms = argv[i] + 5;
+        else if (strncmp(argv[i], "out=", 4) == 0)
+            out = argv[i] + 4;
+        else if (strncmp(argv[i], "icache=", 7) == 0)
+            isize = strtoul(argv[i] + 7, NULL, 0);
+        else if (strncmp(argv[i], "iassoc=", 7) == 0)
+            iassoc = strtoul(argv[i] + 7, NULL, 0);
+        else if (strncmp(argv[i], "dcache=", 7) == 0)
+            dsize = strtoul(argv[i] + 7, NULL, 0);
+        else if (strncmp(argv[i], "dassoc=", 7) == 0)
+            dassoc = strtoul(argv[i] + 7, NULL, 0);
+        else if (strncmp(argv[i], "line=", 5) == 0)
+            line = strtoul(argv[i] + 5, NULL, 0);
+        else if (strncmp(argv[i], "top=", 4) == 0)
+            tm_top = atoi(argv[i] + 4);
+        else {
+            fprintf(stderr, "tm_cache: unknown argument '%s'\n", argv[i]);
+            return -1;
+        }
+    }
+
+    if (line < 4 || (line & (line - 1))) {
+        fprintf(stderr, "tm_cache: line size must be a power of two\n");
+        return -1;
+    }
+    for (tm_line_shift = 0; (1UL << tm_line_shift) < line; tm_line_shift++)
+        ;
+    if (tm_cache_init(&tm_icache, isize, iassoc, line) != 0 ||
+        tm_cache_init(&tm_dcache, dsize, dassoc, line) != 0) {
+        fprintf(stderr, "tm_cache: size/line/assoc must give a power-of-two "
+                        "number of sets\n");
+        return -1;
+    }
+
+    if (!syms || tm_syms_load(syms) <= 0) {
+        fprintf(stderr, "tm_cache: need syms=<nm -S -n output>\n");
+        return -1;
+    }
+    tm_funcs = calloc(tm_nsyms + 1, sizeof(*tm_funcs));
+    if (!tm_funcs || tm_out_open(out) != 0) {
+        fprintf(stderr, "tm_cache: cannot set up output\n");
+        return -1;
+    }
+
+    qemu_plugin_register_vcpu_tb_trans_cb(id, tm_vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, tm_plugin_exit, NULL);
+    return 0;
+}
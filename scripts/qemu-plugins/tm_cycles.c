@@ -0,0 +1,426 @@
+/*
+ * QEMU TCG plugin: cycle-approximate Cortex-M3/M4 cost model.
+ *
+ * Instruction counts treat a one-cycle ADD and a five-cycle LDM alike.
+ * This plugin charges every executed instruction from a per-class cycle
+ * table taken from the Cortex-M3/M4 technical reference manuals, adds
+ * flash wait states to instruction fetches and literal-pool loads, a
+ * pipeline refill to taken branches, and exception entry/exit to every
+ * *_Handler entry.  Each reporting interval of the benchmark (from one
+ * tm_report_period() call to the next) is printed as estimated cycles,
+ * and as cycles per operation when the plugin can read the total
+ * passed to tm_report_period() (register API, QEMU 9.0+).
+ *
+ * Arguments:
+ *   syms=<file>     symbol map from "nm -S -n --defined-only <elf>"
+ *   cpu=m3|m4       cycle table (default m3)
+ *   ws=<n>          flash wait states (default 0)
+ *   flash_end=<a>   end of the flash region (default 0x400000, an385)
+ *   mark=<sym>      interval marker (default tm_report_period)
+ *   out=<file>      write the report here instead of QEMU's log
+ *
+ * The model is static and in-order: no bus contention, no fetch buffer
+ * beyond one 32-bit word per wait-state stall, multi-cycle multiply and
+ * divide at their typical cost, and exception tail-chaining is not
+ * detected.  It is meant for comparing kernels and commits, not for
+ * absolute silicon numbers.
+ */
+
+#include "tm_plugin.h"
+
+#if QEMU_PLUGIN_VERSION >= 2
+#include <glib.h>
+#endif
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+enum {
+    TM_CLS_ALU,
+    TM_CLS_MUL,
+    TM_CLS_DIV,
+    TM_CLS_LOAD,
+    TM_CLS_STORE,
+    TM_CLS_MULTI,
+    TM_CLS_BRANCH,
+    TM_CLS_FP,
+    TM_CLS_FETCH,
+    TM_CLS_EXCEPTION,
+    TM_NCLASSES
+};
+
+static const char *const tm_class_names[TM_NCLASSES] = {
+    "alu",        "multiply", "divide", "load",      "store",
+    "ldm/stm",    "branch",   "fpu",    "flash ws",  "exception",
+};
+
+struct tm_cost_model {
+    const char *name;
+    unsigned int mul;       /* MUL */
+    unsigned int mla;       /* MLA, MLS */
+    unsigned int mull;      /* UMULL, SMULL */
+    unsigned int mlal;      /* UMLAL, SMLAL */
+    unsigned int div;       /* SDIV, UDIV (2-12, early out) */
+    unsigned int load;      /* LDR, LDRB, LDRH, ... */
+    unsigned int store;     /* STR, STRB, STRH, ... */
+    unsigned int refill;    /* pipeline refill after a taken branch */
+    unsigned int exc_entry; /* exception entry, zero wait states */
+    unsigned int exc_exit;  /* exception return */
+    unsigned int fp;        /* VADD, VSUB, VMUL, VMOV, VCVT, ... */
+    unsigned int fp_mac;    /* VMLA, VFMA, ... */
+    unsigned int fp_div;    /* VDIV, VSQRT */
+    unsigned int fp_load;   /* VLDR, VSTR */
+};
+
+static const struct tm_cost_model tm_models[] = {
+    {"m3", 1, 2, 4, 5, 7, 2, 2, 2, 12, 10, 0, 0, 0, 0},
+    {"m4", 1, 1, 1, 1, 7, 2, 2, 2, 12, 10, 1, 3, 14, 2},
+};
+
+static const struct tm_cost_model *tm_model = &tm_models[0];
+static unsigned int tm_ws;
+static uint64_t tm_flash_end = 0x400000;
+
+/* Static cost of one translation block, filled in at translation. */
+struct tm_block {
+    uint64_t pc;
+    uint64_t fallthrough;
+    int cond_branch;
+    unsigned int insns;
+    unsigned int cycles[TM_NCLASSES];
+};
+
+static struct tm_block *tm_last_block;
+static uint64_t tm_cycles[TM_NCLASSES];
+static uint64_t tm_insns;
+static uint64_t tm_interval_cycles, tm_interval_insns;
+static int tm_interval;
+static int tm_mark_sym = -1;
+
+#if QEMU_PLUGIN_VERSION >= 2
+static struct qemu_plugin_register *tm_r0;
+#endif
+
+/* Number of 32-bit registers in the {...} list of ops, expanding ranges;
+ * d registers count twice.
+ */
+static unsigned int tm_reglist_words(const char *ops)
+{
+    const char *p = strchr(ops, '{'), *end;
+    unsigned int words = 0, lo, hi;
+    char kind;
+
+    if (!p || !(end = strchr(p, '}')))
+        return 1;
+    p++;
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == ','))
+            p++;
+        if (p >= end)
+            break;
+        kind = *p;
+        if (sscanf(p + 1, "%u-%*c%u", &lo, &hi) == 2 && hi >= lo)
+            words += (hi - lo + 1) * (kind == 'd' ? 2 : 1);
+        else
+            words += kind == 'd' ? 2 : 1;
+        while (p < end && *p != ',')
+            p++;
+    }
+    return words ? words : 1;
+}
+
+/* Charge one instruction to its class.  *prev_ls tracks whether the
+ * previous instruction was a single load/store, which lets this one
+ * pipeline its address phase (one cycle less).
+ */
+static void tm_classify(struct tm_block *block, const char *disas,
+                        int in_flash, int *prev_ls)
+{
+    char mnem[16];
+    const char *ops;
+    size_t len;
+    unsigned int refill = tm_model->refill + (in_flash ? tm_ws : 0);
+    int ls = 0;
+
+    len = strcspn(disas, " \t");
+    if (len >= sizeof(mnem))
+        len = sizeof(mnem) - 1;
+    memcpy(mnem, disas, len);
+    mnem[len] = '\0';
+    mnem[strcspn(mnem, ".")] = '\0'; /* drop .w/.n and .f32 suffixes */
+    ops = disas + strcspn(disas, " \t");
+
+    block->cond_branch = 0;
+    if (strcmp(mnem, "b") == 0 || strcmp(mnem, "bl") == 0 ||
+        strcmp(mnem, "blx") == 0 || strcmp(mnem, "bx") == 0) {
+        block->cycles[TM_CLS_BRANCH] += 1 + refill;
+    } else if ((mnem[0] == 'b' && strlen(mnem) == 3 && tm_is_cond(mnem + 1)) ||
+               strcmp(mnem, "cbz") == 0 || strcmp(mnem, "cbnz") == 0) {
+        /* Refill charged at run time if the branch is taken. */
+        block->cycles[TM_CLS_BRANCH] += 1;
+        block->cond_branch = 1;
+    } else if (strcmp(mnem, "tbb") == 0 || strcmp(mnem, "tbh") == 0) {
+        block->cycles[TM_CLS_BRANCH] += tm_model->load + refill;
+    } else if (strncmp(mnem, "push", 4) == 0 || strncmp(mnem, "pop", 3) == 0 ||
+               strncmp(mnem, "ldm", 3) == 0 || strncmp(mnem, "stm", 3) == 0) {
+        block->cycles[TM_CLS_MULTI] += 1 + tm_reglist_words(ops);
+        if (strstr(ops, "pc"))
+            block->cycles[TM_CLS_BRANCH] += refill;
+    } else if (strncmp(mnem, "ldrd", 4) == 0 || strncmp(mnem, "strd", 4) == 0) {
+        block->cycles[mnem[0] == 'l' ? TM_CLS_LOAD : TM_CLS_STORE] += 3;
+    } else if (strncmp(mnem, "ldr", 3) == 0) {
+        block->cycles[TM_CLS_LOAD] += tm_model->load - (*prev_ls ? 1 : 0);
+        if (in_flash && strstr(ops, "[pc"))
+            block->cycles[TM_CLS_FETCH] += tm_ws;
+        if (strncmp(ops, " pc,", 4) == 0)
+            block->cycles[TM_CLS_BRANCH] += refill;
+        ls = 1;
+    } else if (strncmp(mnem, "str", 3) == 0) {
+        block->cycles[TM_CLS_STORE] += tm_model->store - (*prev_ls ? 1 : 0);
+        ls = 1;
+    } else if (strncmp(mnem, "mul", 3) == 0) {
+        block->cycles[TM_CLS_MUL] += tm_model->mul;
+    } else if (strncmp(mnem, "mla", 3) == 0 || strncmp(mnem, "mls", 3) == 0) {
+        block->cycles[TM_CLS_MUL] += tm_model->mla;
+    } else if (strncmp(mnem, "umull", 5) == 0 ||
+               strncmp(mnem, "smull", 5) == 0) {
+        block->cycles[TM_CLS_MUL] += tm_model->mull;
+    } else if (strncmp(mnem, "umlal", 5) == 0 ||
+               strncmp(mnem, "smlal", 5) == 0) {
+        block->cycles[TM_CLS_MUL] += tm_model->mlal;
+    } else if (strncmp(mnem, "sdiv", 4) == 0 ||
+               strncmp(mnem, "udiv", 4) == 0) {
+        block->cycles[TM_CLS_DIV] += tm_model->div;
+    } else if (mnem[0] == 'v' && tm_model->fp) {
+        if (strncmp(mnem, "vldr", 4) == 0 || strncmp(mnem, "vstr", 4) == 0)
+            block->cycles[TM_CLS_FP] += tm_model->fp_load;
+        else if (strncmp(mnem, "vpush", 5) == 0 ||
+                 strncmp(mnem, "vpop", 4) == 0 ||
+                 strncmp(mnem, "vldm", 4) == 0 ||
+                 strncmp(mnem, "vstm", 4) == 0)
+            block->cycles[TM_CLS_FP] += 1 + tm_reglist_words(ops);
+        else if (strncmp(mnem, "vdiv", 4) == 0 ||
+                 strncmp(mnem, "vsqrt", 5) == 0)
+            block->cycles[TM_CLS_FP] += tm_model->fp_div;
+        else if (strstr(mnem, "vmla") || strstr(mnem, "vmls") ||
+                 strstr(mnem, "vfm") || strstr(mnem, "vfnm") ||
+                 strstr(mnem, "vnml"))
+            block->cycles[TM_CLS_FP] += tm_model->fp_mac;
+        else
+            block->cycles[TM_CLS_FP] += tm_model->fp;
+    } else {
+        block->cycles[TM_CLS_ALU] += 1;
+        if (strncmp(ops, " pc,", 4) == 0)
+            block->cycles[TM_CLS_BRANCH] += refill;
+    }
+    *prev_ls = ls;
+}
+
+/* Close the current reporting interval. */
+static void tm_mark(unsigned int vcpu_index, void *udata)
+{
+    unsigned long long ops = 0;
+    uint64_t cycles = tm_interval_cycles, insns = tm_interval_insns;
+
+    (void) vcpu_index;
+    (void) udata;
+    tm_interval_cycles = 0;
+    tm_interval_insns = 0;
+
+    /* The first call closes the interval that started at reset. */
+    if (tm_interval++ == 0)
+        return;
+
+#if QEMU_PLUGIN_VERSION >= 2
+    if (tm_r0) {
+        GByteArray *buf = g_byte_array_new();
+        uint32_t r0;
+
+        if (qemu_plugin_read_register(tm_r0, buf) == 4) {
+            memcpy(&r0, buf->data, 4);
+            ops = r0;
+        }
+        g_byte_array_free(buf, TRUE);
+    }
+#endif
+
+    tm_out_printf("tm_cycles: interval %d: %" PRIu64 " cycles, %" PRIu64
+                  " insns, CPI %.2f",
+                  tm_interval - 1, cycles, insns,
+                  insns ? (double) cycles / insns : 0.0);
+    if (ops)
+        tm_out_printf(", %llu ops, %.1f cycles/op, %.1f insns/op\n", ops,
+                      (double) cycles / ops, (double) insns / ops);
+    else
+        tm_out_printf("\n");
+}
+
+static void tm_vcpu_tb_exec(unsigned int vcpu_index, void *udata)
+{
+    struct tm_block *block = udata;
+    uint64_t cycles = 0;
+    int i;
+
+    (void) vcpu_index;
+
+    /* The previous block ended in a conditional branch that was taken. */
+    if (tm_last_block && tm_last_block->cond_branch &&
+        block->pc != tm_last_block->fallthrough) {
+        cycles = tm_model->refill + (block->pc < tm_flash_end ? tm_ws : 0);
+        tm_cycles[TM_CLS_BRANCH] += cycles;
+    }
+    tm_last_block = block;
+
+    for (i = 0; i < TM_NCLASSES; i++) {
+        tm_cycles[i] += block->cycles[i];
+        cycles += block->cycles[i];
+    }
+    tm_insns += block->insns;
+    tm_interval_cycles += cycles;
+    tm_interval_insns += block->insns;
+}
+
+static void tm_vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    size_t n = qemu_plugin_tb_n_insns(tb), i;
+    struct tm_block *block;
+    unsigned int fetch_bytes = 0;
+    int prev_ls = 0, sym;
+
+    (void) id;
+    block = calloc(1, sizeof(*block));
+    if (!block)
+        return;
+    block->pc = qemu_plugin_tb_vaddr(tb);
+    block->insns = n;
+
+    /* Exception handlers are only entered by the hardware. */
+    sym = tm_syms_find(block->pc);
+    if (sym >= 0 && tm_syms[sym].start == block->pc) {
+        size_t len = strlen(tm_syms[sym].name);
+
+        if (len > 8 && strcmp(tm_syms[sym].name + len - 8, "_Handler") == 0)
+            block->cycles[TM_CLS_EXCEPTION] +=
+                tm_model->exc_entry + tm_model->exc_exit;
+    }
+
+    for (i = 0; i < n; i++) {
+        struct qemu_plugin_insn *insn = qemu_plugin_tb_get_insn(tb, i);
+        uint64_t vaddr = qemu_plugin_insn_vaddr(insn);
+        char *disas = qemu_plugin_insn_disas(insn);
+        int in_flash = vaddr < tm_flash_end;
+
+        if (disas) {
+            tm_classify(block, disas, in_flash, &prev_ls);
+            free(disas);
+        } else {
+            block->cycles[TM_CLS_ALU] += 1;
+        }
+        if (in_flash)
+            fetch_bytes += qemu_plugin_insn_size(insn);
+        block->fallthrough = vaddr + qemu_plugin_insn_size(insn);
+
+        if (tm_mark_sym >= 0 && vaddr == tm_syms[tm_mark_sym].start)
+            qemu_plugin_register_vcpu_insn_exec_cb(
+                insn, tm_mark, QEMU_PLUGIN_CB_R_REGS, NULL);
+    }
+    block->cycles[TM_CLS_FETCH] += tm_ws * ((fetch_bytes + 3) / 4);
+
+    qemu_plugin_register_vcpu_tb_exec_cb(tb, tm_vcpu_tb_exec,
+                                         QEMU_PLUGIN_CB_NO_REGS, block);
+}
+
+#if QEMU_PLUGIN_VERSION >= 2
+static void tm_vcpu_init(qemu_plugin_id_t id, unsigned int vcpu_index)
+{
+    GArray *regs = qemu_plugin_get_registers();
+    guint i;
+
+    (void) id;
+    (void) vcpu_index;
+    for (i = 0; regs && i < regs->len; i++) {
+        qemu_plugin_reg_descriptor *rd =
+            &g_array_index(regs, qemu_plugin_reg_descriptor, i);
+
+        if (strcmp(rd->name, "r0") == 0)
+            tm_r0 = rd->handle;
+    }
+    if (regs)
+        g_array_free(regs, TRUE);
+}
+#endif
+
+static void tm_plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    uint64_t total = 0;
+    int i;
+
+    (void) id;
+    (void) p;
+    for (i = 0; i < TM_NCLASSES; i++)
+        total += tm_cycles[i];
+
+    tm_out_printf("# Cycle estimate (cpu=%s ws=%u): %" PRIu64
+                  " cycles, %" PRIu64 " instructions, CPI %.2f\n",
+                  tm_model->name, tm_ws, total, tm_insns,
+                  tm_insns ? (double) total / tm_insns : 0.0);
+    for (i = 0; i < TM_NCLASSES; i++)
+        tm_out_printf("  %-10s %14" PRIu64 " cycles %6.2f%%\n",
+                      tm_class_names[i], tm_cycles[i],
+                      total ? 100.0 * tm_cycles[i] / total : 0.0);
+    tm_out_close();
+}
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_install(qemu_plugin_id_t id,
+                                           const qemu_info_t *info,
+                                           int argc, char **argv)
+{
+    const char *syms = NULL, *out = NULL, *mark = "tm_report_period";
+    size_t m;
+    int i;
+
+    (void) info;
+    for (i = 0; i < argc; i++) {
+        if (strncmp(argv[i], "syms=", 5) == 0) {
+            syms = argv[i] + 5;
+        } else if (strncmp(argv[i], "out=", 4) == 0) {
+            out = argv[i] + 4;
+        } else if (strncmp(argv[i], "mark=", 5) == 0) {
+            mark = argv[i] + 5;
+        } else if (strncmp(argv[i], "ws=", 3) == 0) {
+            tm_ws = strtoul(argv[i] + 3, NULL, 0);
+        } else if (strncmp(argv[i], "flash_end=", 10) == 0) {
+            tm_flash_end = strtoull(argv[i] + 10, NULL, 0);
+        } else if (strncmp(argv[i], "cpu=", 4) == 0) {
+            for (m = 0; m < sizeof(tm_models) / sizeof(tm_models[0]); m++)
+                if (strcmp(argv[i] + 4, tm_models[m].name) == 0)
+                    tm_model = &tm_models[m];
+            if (strcmp(argv[i] + 4, tm_model->name) != 0) {
+                fprintf(stderr, "tm_cycles: unknown cpu '%s'\n", argv[i] + 4);
+                return -1;
+            }
+        } else {
+            fprintf(stderr, "tm_cycles: unknown argument '%s'\n", argv[i]);
+            return -1;
+        }
+    }
+
+    if (!syms || tm_syms_load(syms) <= 0) {
+        fprintf(stderr, "tm_cycles: need syms=<nm -S -n output>\n");
+        return -1;
+    }
+    tm_mark_sym = tm_syms_lookup(mark);
+    if (tm_mark_sym < 0)
+        fprintf(stderr, "tm_cycles: marker '%s' not found, no intervals\n",
+                mark);
+    if (tm_out_open(out) != 0) {
+        fprintf(stderr, "tm_cycles: cannot write %s\n", out);
+        return -1;
+    }
+
+#if QEMU_PLUGIN_VERSION >= 2
+    qemu_plugin_register_vcpu_init_cb(id, tm_vcpu_init);
+#endif
+    qemu_plugin_register_vcpu_tb_trans_cb(id, tm_vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, tm_plugin_exit, NULL);
+    return 0;
+}
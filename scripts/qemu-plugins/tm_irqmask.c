@@ -0,0 +1,422 @@
+/*
+ * QEMU TCG plugin: interrupts-masked windows on Cortex-M.
+ *
+ * Tracks PRIMASK ("cpsid i", "cpsie i", "msr primask") and BASEPRI
+ * ("msr basepri", "msr basepri_max") as the guest executes and records
+ * every window during which either one masks interrupts.  A window's
+ * length is the number of guest instructions executed inside it, which
+ * is deterministic and, under -icount, proportional to time.  At exit it
+ * writes the longest window with where it was opened and closed, a
+ * length histogram, and per masking site (function and its caller) the
+ * window count, maximum and mean.
+ *
+ * Arguments:
+ *   syms=<file>   symbol map from "nm -S -n --defined-only <elf>" (required)
+ *   out=<file>    write the report here instead of QEMU's log
+ *
+ * The value written by "msr" is taken from a preceding "mov rN, #imm" in
+ * the same block when there is one, and otherwise read from the register
+ * (register API, QEMU 9.0+); the caller of the masking function is read
+ * from lr the same way.  Without the register API an unknown value is
+ * counted and assumed to unmask, which ends a window early rather than
+ * inventing a long one.
+ */
+
+#include <strings.h>
+
+#include "tm_plugin.h"
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+enum {
+    TM_OP_CPSID,
+    TM_OP_CPSIE,
+    TM_OP_PRIMASK,
+    TM_OP_BASEPRI,
+    TM_OP_BASEPRI_MAX,
+};
+
+/* One masking instruction, decoded at translation. */
+struct tm_maskop {
+    int kind;
+    int reg;          /* source register of msr, -1 if value is known */
+    uint32_t value;   /* value written by msr, when reg < 0 */
+    unsigned int pos; /* index of the instruction in its block */
+    uint64_t pc;
+};
+
+/* Windows opened by one function, split by its caller. */
+struct tm_site {
+    int caller;
+    uint64_t count;
+    uint64_t total;
+    uint64_t max;
+    struct tm_site *next;
+};
+
+#define TM_HIST_BUCKETS 10 /* <16, <32, ... <4096, >=4096 instructions */
+#define TM_REG_LR 14
+
+static uint64_t tm_insns;   /* instructions executed so far */
+static uint64_t tm_tb_base; /* tm_insns at the start of this block */
+
+static uint32_t tm_primask, tm_basepri;
+static uint64_t tm_open_at, tm_open_pc;
+static struct tm_site *tm_open_site;
+
+static struct tm_site **tm_sites; /* per symbol; index tm_nsyms = none */
+static uint64_t tm_hist[TM_HIST_BUCKETS];
+static uint64_t tm_windows, tm_window_insns, tm_unknown_values;
+static uint64_t tm_max, tm_max_open_pc, tm_max_close_pc;
+
+#if QEMU_PLUGIN_VERSION >= 2
+static struct qemu_plugin_register *tm_regs[15]; /* r0-r12, sp, lr */
+#endif
+
+/* Read core register reg, or return 0 and set *ok to 0. */
+static uint32_t tm_read_reg(int reg, int *ok)
+{
+#if QEMU_PLUGIN_VERSION >= 2
+    uint32_t value = 0;
+
+    if (reg >= 0 && reg < 15 && tm_regs[reg]) {
+        GByteArray *buf = g_byte_array_new();
+
+        if (qemu_plugin_read_register(tm_regs[reg], buf) == 4) {
+            memcpy(&value, buf->data, 4);
+            g_byte_array_free(buf, TRUE);
+            *ok = 1;
+            return value;
+        }
+        g_byte_array_free(buf, TRUE);
+    }
+#else
+    (void) reg;
+#endif
+    *ok = 0;
+    return 0;
+}
+
+static struct tm_site *tm_site_get(uint64_t pc, int caller)
+{
+    int sym = tm_syms_find(pc);
+    struct tm_site **head = &tm_sites[sym < 0 ? tm_nsyms : sym], *site;
+
+    for (site = *head; site; site = site->next)
+        if (site->caller == caller)
+            return site;
+    site = calloc(1, sizeof(*site));
+    if (!site)
+        return NULL;
+    site->caller = caller;
+    site->next = *head;
+    *head = site;
+    return site;
+}
+
+static void tm_window_close(uint64_t now, uint64_t pc)
+{
+    uint64_t len = now - tm_open_at;
+    int bucket = 0;
+
+    while (bucket < TM_HIST_BUCKETS - 1 && len >= (16ULL << bucket))
+        bucket++;
+    tm_hist[bucket]++;
+    tm_windows++;
+    tm_window_insns += len;
+    if (len > tm_max) {
+        tm_max = len;
+        tm_max_open_pc = tm_open_pc;
+        tm_max_close_pc = pc;
+    }
+    if (tm_open_site) {
+        tm_open_site->count++;
+        tm_open_site->total += len;
+        if (len > tm_open_site->max)
+            tm_open_site->max = len;
+    }
+}
+
+static void tm_vcpu_maskop_exec(unsigned int vcpu_index, void *udata)
+{
+    struct tm_maskop *op = udata;
+    uint64_t now = tm_tb_base + op->pos;
+    uint32_t value = op->value;
+    int was_masked = tm_primask || tm_basepri, ok = 1;
+
+    (void) vcpu_index;
+    if (op->kind >= TM_OP_PRIMASK && op->reg >= 0) {
+        value = tm_read_reg(op->reg, &ok);
+        if (!ok)
+            tm_unknown_values++;
+    }
+
+    switch (op->kind) {
+    case TM_OP_CPSID:
+        tm_primask = 1;
+        break;
+    case TM_OP_CPSIE:
+        tm_primask = 0;
+        break;
+    case TM_OP_PRIMASK:
+        tm_primask = value & 1;
+        break;
+    case TM_OP_BASEPRI:
+        tm_basepri = value & 0xff;
+        break;
+    case TM_OP_BASEPRI_MAX:
+        value &= 0xff;
+        if (value && (!tm_basepri || value < tm_basepri))
+            tm_basepri = value;
+        break;
+    }
+
+    if (!was_masked && (tm_primask || tm_basepri)) {
+        uint32_t lr = tm_read_reg(TM_REG_LR, &ok);
+
+        tm_open_at = now;
+        tm_open_pc = op->pc;
+        tm_open_site = tm_site_get(op->pc, ok ? tm_syms_find(lr & ~1U) : -1);
+    } else if (was_masked && !tm_primask && !tm_basepri) {
+        tm_window_close(now, op->pc);
+    }
+}
+
+static void tm_vcpu_tb_exec(unsigned int vcpu_index, void *udata)
+{
+    (void) vcpu_index;
+    tm_tb_base = tm_insns;
+    tm_insns += (uintptr_t) udata;
+}
+
+/* Register number of "rN", its alias, "sp" or "lr", or -1. */
+static int tm_reg_number(const char *name)
+{
+    static const char *const aliases[] = {"sb", "sl", "fp", "ip", "sp", "lr"};
+    int i;
+
+    if (name[0] == 'r' && name[1] >= '0' && name[1] <= '9')
+        return atoi(name + 1);
+    for (i = 0; i < 6; i++)
+        if (strncmp(name, aliases[i], 2) == 0)
+            return 9 + i;
+    return -1;
+}
+
+static void tm_vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    size_t n = qemu_plugin_tb_n_insns(tb), i;
+    int known[13] = {0}; /* register set by "mov rN, #imm" in this block */
+    uint32_t imm[13];
+
+    (void) id;
+    qemu_plugin_register_vcpu_tb_exec_cb(tb, tm_vcpu_tb_exec,
+                                         QEMU_PLUGIN_CB_NO_REGS,
+                                         (void *) (uintptr_t) n);
+
+    for (i = 0; i < n; i++) {
+        struct qemu_plugin_insn *insn = qemu_plugin_tb_get_insn(tb, i);
+        char *disas = qemu_plugin_insn_disas(insn);
+        struct tm_maskop *op;
+        char mnem[16], dst[16], src[16];
+        int kind = -1, reg = -1, fields;
+        unsigned int value = 0;
+
+        if (!disas)
+            continue;
+        fields = sscanf(disas, "%15s %15[^, ], %15s", mnem, dst, src);
+        mnem[strcspn(mnem, ".")] = '\0';
+        if (fields >= 2 && strcmp(mnem, "cpsid") == 0 && strchr(dst, 'i')) {
+            kind = TM_OP_CPSID;
+        } else if (fields >= 2 && strcmp(mnem, "cpsie") == 0 &&
+                   strchr(dst, 'i')) {
+            kind = TM_OP_CPSIE;
+        } else if (fields == 3 && strcmp(mnem, "msr") == 0) {
+            if (strcasecmp(dst, "primask") == 0)
+                kind = TM_OP_PRIMASK;
+            else if (strcasecmp(dst, "basepri") == 0)
+                kind = TM_OP_BASEPRI;
+            else if (strcasecmp(dst, "basepri_max") == 0)
+                kind = TM_OP_BASEPRI_MAX;
+            reg = tm_reg_number(src);
+            if (reg >= 0 && reg < 13 && known[reg]) {
+                value = imm[reg];
+                reg = -1;
+            }
+        } else if (fields == 3 && strncmp(mnem, "mov", 3) == 0 &&
+                   strcmp(mnem, "movt") != 0 &&
+                   (reg = tm_reg_number(dst)) >= 0 && reg < 13) {
+            /* Remember "mov rN, #imm"; any other write forgets it. */
+            known[reg] = sscanf(src, "#%i", &value) == 1;
+            imm[reg] = value;
+        } else if (fields >= 2 && (reg = tm_reg_number(dst)) >= 0 &&
+                   reg < 13) {
+            known[reg] = 0;
+        }
+        free(disas);
+        if (kind < 0)
+            continue;
+
+        op = malloc(sizeof(*op));
+        if (!op)
+            continue;
+        op->kind = kind;
+        op->reg = kind >= TM_OP_PRIMASK ? reg : -1;
+        op->value = value;
+        op->pos = i;
+        op->pc = qemu_plugin_insn_vaddr(insn);
+        qemu_plugin_register_vcpu_insn_exec_cb(insn, tm_vcpu_maskop_exec,
+                                               QEMU_PLUGIN_CB_R_REGS, op);
+    }
+}
+
+#if QEMU_PLUGIN_VERSION >= 2
+static void tm_vcpu_init(qemu_plugin_id_t id, unsigned int vcpu_index)
+{
+    GArray *regs = qemu_plugin_get_registers();
+    guint i;
+    int reg;
+
+    (void) id;
+    (void) vcpu_index;
+    for (i = 0; regs && i < regs->len; i++) {
+        qemu_plugin_reg_descriptor *rd =
+            &g_array_index(regs, qemu_plugin_reg_descriptor, i);
+
+        reg = tm_reg_number(rd->name);
+        if (reg >= 0 && reg < 15 && strlen(rd->name) <= 3)
+            tm_regs[reg] = rd->handle;
+    }
+    if (regs)
+        g_array_free(regs, TRUE);
+}
+#endif
+
+/* Format pc as function+offset. */
+static const char *tm_where(uint64_t pc, char *buf, size_t size)
+{
+    int sym = tm_syms_find(pc);
+
+    if (sym < 0)
+        snprintf(buf, size, "0x%" PRIx64, pc);
+    else
+        snprintf(buf, size, "%s+0x%" PRIx64, tm_syms[sym].name,
+                 pc - tm_syms[sym].start);
+    return buf;
+}
+
+struct tm_site_ref {
+    int sym;
+    struct tm_site *site;
+};
+
+static int tm_site_cmp_max(const void *a, const void *b)
+{
+    const struct tm_site_ref *ra = a, *rb = b;
+
+    if (ra->site->max != rb->site->max)
+        return ra->site->max > rb->site->max ? -1 : 1;
+    return 0;
+}
+
+static void tm_plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    struct tm_site_ref *refs;
+    struct tm_site *site;
+    char open[96], close[96], name[96];
+    int i, nrefs = 0;
+
+    (void) id;
+    (void) p;
+
+    tm_out_printf("# Interrupts-masked windows: %" PRIu64
+                  ", longest %" PRIu64 " insns, mean %.1f insns, %.2f%% of "
+                  "%" PRIu64 " insns\n",
+                  tm_windows, tm_max,
+                  tm_windows ? (double) tm_window_insns / tm_windows : 0.0,
+                  tm_insns ? 100.0 * tm_window_insns / tm_insns : 0.0,
+                  tm_insns);
+    if (tm_windows)
+        tm_out_printf("# Longest: masked at %s, unmasked at %s\n",
+                      tm_where(tm_max_open_pc, open, sizeof(open)),
+                      tm_where(tm_max_close_pc, close, sizeof(close)));
+    if (tm_unknown_values)
+        tm_out_printf("# %" PRIu64 " msr values unknown (no register API), "
+                      "assumed to unmask\n",
+                      tm_unknown_values);
+
+    tm_out_printf("# Length histogram (insns):\n");
+    for (i = 0; i < TM_HIST_BUCKETS; i++) {
+        if (i < TM_HIST_BUCKETS - 1)
+            snprintf(name, sizeof(name), "<%llu", 16ULL << i);
+        else
+            snprintf(name, sizeof(name), ">=%llu", 16ULL << (i - 1));
+        tm_out_printf("  %-8s %12" PRIu64 "\n", name, tm_hist[i]);
+    }
+
+    for (i = 0; i <= tm_nsyms; i++)
+        for (site = tm_sites[i]; site; site = site->next)
+            nrefs++;
+    refs = malloc((nrefs ? nrefs : 1) * sizeof(*refs));
+    nrefs = 0;
+    for (i = 0; refs && i <= tm_nsyms; i++)
+        for (site = tm_sites[i]; site; site = site->next) {
+            refs[nrefs].sym = i;
+            refs[nrefs].site = site;
+            nrefs++;
+        }
+    if (refs) {
+        qsort(refs, nrefs, sizeof(*refs), tm_site_cmp_max);
+        tm_out_printf("# %-52s %10s %8s %8s\n", "masking function <- caller",
+                      "windows", "max", "mean");
+        for (i = 0; i < nrefs; i++) {
+            site = refs[i].site;
+            snprintf(name, sizeof(name), "%s <- %s",
+                     refs[i].sym < tm_nsyms ? tm_syms[refs[i].sym].name : "?",
+                     site->caller >= 0 ? tm_syms[site->caller].name : "?");
+            tm_out_printf("  %-52s %10" PRIu64 " %8" PRIu64 " %8.1f\n", name,
+                          site->count, site->max,
+                          site->count ? (double) site->total / site->count
+                                      : 0.0);
+        }
+        free(refs);
+    }
+    tm_out_close();
+}
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_install(qemu_plugin_id_t id,
+                                           const qemu_info_t *info,
+                                           int argc, char **argv)
+{
+    const char *syms = NULL, *out = NULL;
+    int i;
+
+    (void) info;
+    for (i = 0; i < argc; i++) {
+        if (strncmp(argv[i], "syms=", 5) == 0)
+            syms = argv[i] + 5;
+        else if (strncmp(argv[i], "out=", 4) == 0)
+            out = argv[i] + 4;
+        else {
+            fprintf(stderr, "tm_irqmask: unknown argument '%s'\n", argv[i]);
+            return -1;
+        }
+    }
+
+    if (!syms || tm_syms_load(syms) <= 0) {
+        fprintf(stderr, "tm_irqmask: need syms=<nm -S -n output>\n");
+        return -1;
+    }
+    tm_sites = calloc(tm_nsyms + 1, sizeof(*tm_sites));
+    if (!tm_sites || tm_out_open(out) != 0) {
+        fprintf(stderr, "tm_irqmask: cannot set up output\n");
+        return -1;
+    }
+
+#if QEMU_PLUGIN_VERSION >= 2
+    qemu_plugin_register_vcpu_init_cb(id, tm_vcpu_init);
+#endif
+    qemu_plugin_register_vcpu_tb_trans_cb(id, tm_vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, tm_plugin_exit, NULL);
+    return 0;
+}
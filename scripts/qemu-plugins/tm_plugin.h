@@ -0,0 +1,151 @@
+/*
+ * Helpers shared by the Thread-Metric QEMU plugins: the ELF symbol map
+ * and report output.  Header-only so each plugin stays a single
+ * translation unit.
+ */
+
+#ifndef TM_PLUGIN_H
+#define TM_PLUGIN_H
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <qemu-plugin.h>
+
+struct tm_sym {
+    uint64_t start;
+    uint64_t end;
+    char *name;
+};
+
+static struct tm_sym *tm_syms;
+static int tm_nsyms;
+
+static inline int tm_sym_cmp(const void *a, const void *b)
+{
+    const struct tm_sym *sa = a, *sb = b;
+
+    return sa->start < sb->start ? -1 : sa->start > sb->start;
+}
+
+/* Load sized text symbols from "nm -S -n --defined-only" output.  Thumb
+ * function addresses carry bit 0 in the symbol table, so it is cleared.
+ * Returns the number of symbols, or -1 on error.
+ */
+static inline int tm_syms_load(const char *path)
+{
+    FILE *f;
+    char line[512], type, name[400];
+    uint64_t addr, size;
+    int cap = 0;
+
+    f = fopen(path, "r");
+    if (!f)
+        return -1;
+
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%" SCNx64 " %" SCNx64 " %c %399s", &addr, &size,
+                   &type, name) != 4)
+            continue;
+        if (size == 0 || !strchr("tTwW", type))
+            continue;
+        if (tm_nsyms == cap) {
+            cap = cap ? cap * 2 : 256;
+            tm_syms = realloc(tm_syms, cap * sizeof(*tm_syms));
+            if (!tm_syms) {
+                fclose(f);
+                return -1;
+            }
+        }
+        tm_syms[tm_nsyms].start = addr & ~(uint64_t) 1;
+        tm_syms[tm_nsyms].end = tm_syms[tm_nsyms].start + size;
+        tm_syms[tm_nsyms].name = strdup(name);
+        tm_nsyms++;
+    }
+    fclose(f);
+
+    qsort(tm_syms, tm_nsyms, sizeof(*tm_syms), tm_sym_cmp);
+    return tm_nsyms;
+}
+
+/* Index of the symbol containing addr, or -1. */
+static inline int tm_syms_find(uint64_t addr)
+{
+    int lo = 0, hi = tm_nsyms - 1, mid;
+
+    while (lo <= hi) {
+        mid = lo + (hi - lo) / 2;
+        if (addr < tm_syms[mid].start)
+            hi = mid - 1;
+        else if (addr >= tm_syms[mid].end)
+            lo = mid + 1;
+        else
+            return mid;
+    }
+    return -1;
+}
+
+/* Index of the symbol called name, or -1. */
+static inline int tm_syms_lookup(const char *name)
+{
+    int i;
+
+    for (i = 0; i < tm_nsyms; i++)
+        if (strcmp(tm_syms[i].name, name) == 0)
+            return i;
+    return -1;
+}
+
+/* 1 if cc is an Arm condition-code suffix ("eq" in "beq"). */
+static inline int tm_is_cond(const char *cc)
+{
+    static const char *const conds[] = {"eq", "ne", "cs", "hs", "cc", "lo",
+                                        "mi", "pl", "vs", "vc", "hi", "ls",
+                                        "ge", "lt", "gt", "le"};
+    size_t i;
+
+    for (i = 0; i < sizeof(conds) / sizeof(conds[0]); i++)
+        if (strcmp(cc, conds[i]) == 0)
+            return 1;
+    return 0;
+}
+
+/* Report output: the out= file if one was given, QEMU's log otherwise. */
+static FILE *tm_out;
+
+static inline int tm_out_open(const char *path)
+{
+    if (!path)
+        return 0;
+    tm_out = fopen(path, "w");
+    return tm_out ? 0 : -1;
+}
+
+static inline void tm_out_printf(const char *fmt, ...)
+    __attribute__((format(printf, 1, 2)));
+
+static inline void tm_out_printf(const char *fmt, ...)
+{
+    char line[512];
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (tm_out)
+        fputs(line, tm_out);
+    else
+        qemu_plugin_outs(line);
+}
+
+static inline void tm_out_close(void)
+{
+    if (tm_out)
+        fclose(tm_out);
+    tm_out = NULL;
+}
+
+#endif /* TM_PLUGIN_H */
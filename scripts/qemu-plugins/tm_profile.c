@@ -0,0 +1,567 @@
+/*
+ * QEMU TCG plugin: per-function instruction profile for Thread-Metric.
+ *
+ * Attributes every guest instruction executed to the ELF function that
+ * contains it and counts calls as executions of a function's first
+ * instruction.  At exit it writes, per function, the number of calls,
+ * the instructions executed inside it (self, not including callees), the
+ * instructions executed inside it or anything it called (inclusive), and
+ * both per call.  Instruction counts do not depend on host speed, so a
+ * kernel regression shows up as extra instructions in the exact API that
+ * grew, and the inclusive figures show which test-facing call it landed
+ * under.
+ *
+ * Arguments:
+ *   syms=<file>   symbol map from "nm -S -n --defined-only <elf>" (required)
+ *   out=<file>    write the profile here instead of QEMU's log (stderr)
+ *
+ * Counting happens per translation block: each block is split at
+ * function boundaries when it is translated, and one callback per
+ * executed block adds the counts.  A block cut short by an exception is
+ * still counted whole, which over-counts by at most a few instructions
+ * per interrupt.
+ *
+ * Inclusive counts come from a shadow call stack.  The last instruction
+ * of each block is classified from its disassembly when the block is
+ * translated (call, jump or return, Thumb-2 or RISC-V), and the next
+ * block executed shows where it went: a call pushes the callee with its
+ * return address, a return pops back to the frame expecting that
+ * address, and a jump to a function entry is a tail call.  Landing on a
+ * function entry any other way is an exception or a new thread, which
+ * opens a stack of its own so that interrupt and thread work is not
+ * charged to whatever it preempted.  A return matching the top of
+ * another stack resumes that stack, which is how a switched-in thread
+ * finds its frames again; its first few instructions after the switch
+ * may still be charged to the previous context.
+ */
+
+#include "tm_plugin.h"
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+/* Per-symbol counters, indexed like tm_syms. */
+struct tm_func {
+    uint64_t calls;
+    uint64_t insns;
+    uint64_t incl;
+};
+
+/* How the last instruction of a block leaves it. */
+enum { TM_FLOW_NONE, TM_FLOW_CALL, TM_FLOW_JUMP, TM_FLOW_RETURN };
+
+/* A run of consecutive instructions of one translation block that fall
+ * into the same function.
+ */
+struct tm_span {
+    int func;
+    int entry;
+    unsigned int insns;
+};
+
+struct tm_block {
+    uint64_t pc;          /* first instruction */
+    uint64_t fallthrough; /* address after the last instruction */
+    uint64_t target;      /* direct branch destination, 0 if unknown */
+    int flow;
+    int handler; /* starts a *_Handler, only entered by exceptions */
+    int nspans;
+    struct tm_span spans[];
+};
+
+/* One shadow call stack frame. */
+struct tm_frame {
+    int func;     /* symbol index, -1 for code without one */
+    int dup;      /* func is also further down (recursion) */
+    uint64_t ret; /* address it returns to, 0 for a context's first */
+};
+
+#define TM_STACKS 64
+#define TM_STACK_DEPTH 128
+
+/* Shadow stack of one execution context: a thread or an exception.
+ * armed records a call preempted before the callee's first instruction,
+ * completed when the context resumes at the callee.
+ */
+struct tm_stack {
+    int depth;
+    int armed;
+    uint64_t armed_target;
+    uint64_t armed_ret;
+    uint64_t stamp; /* when it was last left, for resume and reuse */
+    struct tm_frame frames[TM_STACK_DEPTH];
+};
+
+static struct tm_func *tm_funcs;
+static uint64_t tm_unknown_insns;
+
+static struct tm_stack tm_stacks[TM_STACKS];
+static struct tm_stack *tm_cur = &tm_stacks[0];
+static const struct tm_block *tm_prev;
+static uint64_t tm_clock;
+static uint64_t tm_lost_frames;
+
+static int tm_func_cmp_insns(const void *a, const void *b)
+{
+    int ia = *(const int *) a, ib = *(const int *) b;
+
+    if (tm_funcs[ia].insns != tm_funcs[ib].insns)
+        return tm_funcs[ia].insns > tm_funcs[ib].insns ? -1 : 1;
+    return 0;
+}
+
+static void tm_push(int func, uint64_t ret)
+{
+    struct tm_frame *frame;
+    int i, dup = 0;
+
+    if (tm_cur->depth == TM_STACK_DEPTH) {
+        tm_lost_frames++;
+        return;
+    }
+    for (i = 0; func >= 0 && i < tm_cur->depth; i++)
+        if (tm_cur->frames[i].func == func)
+            dup = 1;
+    frame = &tm_cur->frames[tm_cur->depth++];
+    frame->func = func;
+    frame->dup = dup;
+    frame->ret = ret;
+}
+
+/* Return address of the innermost frame, 0 if the stack is empty. */
+static uint64_t tm_top_ret(const struct tm_stack *stack)
+{
+    return stack->depth ? stack->frames[stack->depth - 1].ret : 0;
+}
+
+/* Pop the innermost frames returning to ret; a tail-called frame shares
+ * its caller's return address, so both go at once.
+ */
+static void tm_pop_to(struct tm_stack *stack, uint64_t ret)
+{
+    while (stack->depth && stack->frames[stack->depth - 1].ret == ret)
+        stack->depth--;
+}
+
+/* Jump or fall-through into func, which takes over the innermost
+ * frame's return address.  A branch back to a function's own entry is
+ * a loop, not a call.
+ */
+static void tm_tail(int func)
+{
+    if (tm_cur->depth && tm_cur->frames[tm_cur->depth - 1].func == func)
+        return;
+    tm_push(func, tm_top_ret(tm_cur));
+}
+
+static void tm_switch(struct tm_stack *stack)
+{
+    tm_cur->stamp = ++tm_clock;
+    tm_cur = stack;
+}
+
+/* An exception or a new thread starts at func.  The context it preempts
+ * keeps its stack; an empty one is reused, else the least recently left.
+ */
+static void tm_context_new(int func)
+{
+    struct tm_stack *stack = NULL;
+    int i;
+
+    if (tm_cur->depth) {
+        for (i = 0; i < TM_STACKS; i++) {
+            struct tm_stack *s = &tm_stacks[i];
+
+            if (s == tm_cur)
+                continue;
+            if (!s->depth) {
+                stack = s;
+                break;
+            }
+            if (!stack || s->stamp < stack->stamp)
+                stack = s;
+        }
+        tm_switch(stack);
+    }
+    tm_cur->depth = 0;
+    tm_cur->armed = 0;
+    tm_push(func, 0);
+}
+
+/* 1 if stack was preempted on its way into a call landing at pc. */
+static int tm_armed_for(const struct tm_stack *stack, uint64_t pc, int entry)
+{
+    if (!stack->armed)
+        return 0;
+    return stack->armed_target ? stack->armed_target == pc : entry;
+}
+
+/* The current context ran out of frames after an exception return that
+ * landed at pc, in func.  Resume the context that was about to enter a
+ * call there, else the one whose innermost frame is func, else the one
+ * most recently left.
+ */
+static void tm_context_resume(uint64_t pc, int func, int entry)
+{
+    struct tm_stack *stack = NULL;
+    int i, match = 0;
+
+    for (i = 0; i < TM_STACKS; i++) {
+        struct tm_stack *s = &tm_stacks[i];
+        int m;
+
+        if (s == tm_cur || !s->depth)
+            continue;
+        m = tm_armed_for(s, pc, entry) ? 2
+                                       : s->frames[s->depth - 1].func == func;
+        if (!stack || m > match || (m == match && s->stamp > stack->stamp)) {
+            stack = s;
+            match = m;
+        }
+    }
+    if (stack)
+        tm_switch(stack);
+}
+
+/* A return, or an exception return, landed at pc. */
+static void tm_return(uint64_t pc, int func, int entry)
+{
+    int i;
+
+    if (tm_cur->depth && tm_top_ret(tm_cur) == pc) {
+        tm_pop_to(tm_cur, pc);
+        return;
+    }
+    /* A thread switched in by the scheduler returning from its own frame. */
+    for (i = 0; i < TM_STACKS; i++) {
+        struct tm_stack *s = &tm_stacks[i];
+
+        if (s != tm_cur && s->depth && tm_top_ret(s) == pc) {
+            tm_switch(s);
+            tm_cur->armed = 0;
+            tm_pop_to(tm_cur, pc);
+            return;
+        }
+    }
+    /* A return the stack missed (longjmp, unclassified branch). */
+    for (i = tm_cur->depth - 1; i > 0; i--) {
+        if (tm_cur->frames[i - 1].ret == pc) {
+            tm_cur->depth = i;
+            tm_pop_to(tm_cur, pc);
+            return;
+        }
+    }
+
+    /* Exception return: leave the handler's frame. */
+    if (tm_cur->depth)
+        tm_cur->depth--;
+    if (!tm_cur->depth)
+        tm_context_resume(pc, func, entry);
+    if (tm_armed_for(tm_cur, pc, entry)) {
+        tm_cur->armed = 0;
+        tm_push(func, tm_cur->armed_ret);
+        return;
+    }
+    if (entry)
+        tm_context_new(func);
+}
+
+/* 1 if block was reached by the branch ending prev. */
+static int tm_taken(const struct tm_block *prev, const struct tm_block *block)
+{
+    if (prev->target)
+        return block->pc == prev->target;
+    return !block->handler;
+}
+
+/* Update the shadow stack for the control transfer from the previous
+ * block executed into block.
+ */
+static void tm_flow(const struct tm_block *block)
+{
+    const struct tm_block *prev = tm_prev;
+    int func = block->nspans ? block->spans[0].func : -1;
+    int entry = block->nspans && block->spans[0].entry;
+
+    tm_prev = block;
+    if (!prev) {
+        if (entry)
+            tm_context_new(func);
+        return;
+    }
+
+    switch (prev->flow) {
+    case TM_FLOW_CALL:
+        if (tm_taken(prev, block)) {
+            tm_push(entry ? func : -1, prev->fallthrough);
+            return;
+        }
+        tm_cur->armed = 1;
+        tm_cur->armed_target = prev->target;
+        tm_cur->armed_ret = prev->fallthrough;
+        break;
+    case TM_FLOW_JUMP:
+        if (block->pc == prev->fallthrough)
+            return;
+        if (tm_taken(prev, block)) {
+            if (entry)
+                tm_tail(func);
+            return;
+        }
+        break;
+    case TM_FLOW_RETURN:
+        if (block->pc != prev->fallthrough)
+            tm_return(block->pc, func, entry);
+        return;
+    default:
+        if (block->pc == prev->fallthrough) {
+            if (entry)
+                tm_tail(func);
+            return;
+        }
+        break;
+    }
+
+    /* Not where the previous block was heading: an exception. */
+    if (entry)
+        tm_context_new(func);
+}
+
+static void tm_vcpu_tb_exec(unsigned int vcpu_index, void *udata)
+{
+    struct tm_block *block = udata;
+    int i, j;
+
+    (void) vcpu_index;
+    tm_flow(block);
+    for (i = 0; i < block->nspans; i++) {
+        struct tm_span *span = &block->spans[i];
+
+        /* Fell through into the next function. */
+        if (i > 0 && span->entry)
+            tm_tail(span->func);
+
+        for (j = 0; j < tm_cur->depth; j++) {
+            struct tm_frame *frame = &tm_cur->frames[j];
+
+            if (frame->func >= 0 && frame->func != span->func && !frame->dup)
+                tm_funcs[frame->func].incl += span->insns;
+        }
+        if (span->func < 0) {
+            tm_unknown_insns += span->insns;
+            continue;
+        }
+        tm_funcs[span->func].insns += span->insns;
+        tm_funcs[span->func].incl += span->insns;
+        tm_funcs[span->func].calls += span->entry;
+    }
+}
+
+/* 1 if the operand text starts with register reg. */
+static int tm_op_is(const char *ops, const char *reg)
+{
+    size_t len = strlen(reg);
+
+    return strncmp(ops, reg, len) == 0 && strchr(" \t,", ops[len]);
+}
+
+/* How an instruction leaves its block, from QEMU's disassembly of
+ * Thumb-2 (capstone syntax) or RISC-V.  *target is set to a direct
+ * branch's destination when the text carries one.
+ */
+static int tm_classify_flow(const char *disas, uint64_t *target)
+{
+    static const char *const rv_branches[] = {
+        "beq",  "bne",  "blt",  "bge",  "bltu", "bgeu", "beqz", "bnez",
+        "blez", "bgez", "bltz", "bgtz", "bgt",  "ble",  "bgtu", "bleu"};
+    char mnem[16];
+    const char *ops, *hash;
+    size_t len, i;
+
+    len = strcspn(disas, " \t");
+    if (len >= sizeof(mnem))
+        len = sizeof(mnem) - 1;
+    memcpy(mnem, disas, len);
+    mnem[len] = '\0';
+    if (strncmp(mnem, "c.", 2) == 0) /* RISC-V compressed forms */
+        memmove(mnem, mnem + 2, len - 1);
+    mnem[strcspn(mnem, ".")] = '\0'; /* drop .w/.n */
+    ops = disas + len;
+    ops += strspn(ops, " \t");
+
+    hash = strchr(ops, '#');
+    *target = hash ? strtoull(hash + 1 + strspn(hash + 1, " "), NULL, 0) : 0;
+    *target &= ~(uint64_t) 1;
+
+    /* Thumb-2 */
+    if (strcmp(mnem, "bl") == 0 || strcmp(mnem, "blx") == 0)
+        return TM_FLOW_CALL;
+    if (strncmp(mnem, "bx", 2) == 0 && (!mnem[2] || tm_is_cond(mnem + 2))) {
+        *target = 0;
+        return tm_op_is(ops, "lr") ? TM_FLOW_RETURN : TM_FLOW_JUMP;
+    }
+    if (strcmp(mnem, "b") == 0 || strcmp(mnem, "cbz") == 0 ||
+        strcmp(mnem, "cbnz") == 0 || (mnem[0] == 'b' && tm_is_cond(mnem + 1)))
+        return TM_FLOW_JUMP;
+    if ((strncmp(mnem, "pop", 3) == 0 || strncmp(mnem, "ldm", 3) == 0) &&
+        strstr(ops, "pc"))
+        return TM_FLOW_RETURN;
+    if ((strncmp(mnem, "ldr", 3) == 0 || strcmp(mnem, "mov") == 0) &&
+        tm_op_is(ops, "pc")) {
+        *target = 0;
+        return TM_FLOW_RETURN;
+    }
+
+    /* RISC-V */
+    if (strcmp(mnem, "ret") == 0 || strcmp(mnem, "mret") == 0 ||
+        strcmp(mnem, "sret") == 0)
+        return TM_FLOW_RETURN;
+    if (strcmp(mnem, "jr") == 0) {
+        *target = 0;
+        return tm_op_is(ops, "ra") ? TM_FLOW_RETURN : TM_FLOW_JUMP;
+    }
+    if (strcmp(mnem, "jalr") == 0) {
+        *target = 0;
+        if (!tm_op_is(ops, "zero"))
+            return TM_FLOW_CALL;
+        return tm_op_is(ops + 5, "ra") ? TM_FLOW_RETURN : TM_FLOW_JUMP;
+    }
+    if (strcmp(mnem, "jal") == 0 || strcmp(mnem, "call") == 0)
+        return tm_op_is(ops, "zero") ? TM_FLOW_JUMP : TM_FLOW_CALL;
+    if (strcmp(mnem, "j") == 0 || strcmp(mnem, "tail") == 0)
+        return TM_FLOW_JUMP;
+    for (i = 0; i < sizeof(rv_branches) / sizeof(rv_branches[0]); i++)
+        if (strcmp(mnem, rv_branches[i]) == 0)
+            return TM_FLOW_JUMP;
+
+    *target = 0;
+    return TM_FLOW_NONE;
+}
+
+/* Translation blocks are cached by QEMU, so this runs once per block
+ * (and again only after a code-cache flush).
+ */
+static void tm_vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    size_t n = qemu_plugin_tb_n_insns(tb), i;
+    struct tm_block *block;
+    struct tm_span *span = NULL;
+    char *disas;
+
+    (void) id;
+    block = calloc(1, sizeof(*block) + n * sizeof(block->spans[0]));
+    if (!block)
+        return;
+    block->pc = qemu_plugin_tb_vaddr(tb);
+
+    for (i = 0; i < n; i++) {
+        struct qemu_plugin_insn *insn = qemu_plugin_tb_get_insn(tb, i);
+        uint64_t vaddr = qemu_plugin_insn_vaddr(insn);
+        int func = tm_syms_find(vaddr);
+        int entry = func >= 0 && vaddr == tm_syms[func].start;
+
+        if (!span || span->func != func || entry) {
+            span = &block->spans[block->nspans++];
+            span->func = func;
+            span->entry = entry;
+            span->insns = 0;
+        }
+        span->insns++;
+        block->fallthrough = vaddr + qemu_plugin_insn_size(insn);
+    }
+
+    if (n) {
+        disas = qemu_plugin_insn_disas(qemu_plugin_tb_get_insn(tb, n - 1));
+        if (disas) {
+            block->flow = tm_classify_flow(disas, &block->target);
+            free(disas);
+        }
+    }
+    if (block->nspans && block->spans[0].entry) {
+        const char *name = tm_syms[block->spans[0].func].name;
+        size_t len = strlen(name);
+
+        block->handler = len > 8 && strcmp(name + len - 8, "_Handler") == 0;
+    }
+
+    qemu_plugin_register_vcpu_tb_exec_cb(tb, tm_vcpu_tb_exec,
+                                         QEMU_PLUGIN_CB_NO_REGS, block);
+}
+
+static void tm_plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    uint64_t total = tm_unknown_insns;
+    int *sorted;
+    int i;
+
+    (void) id;
+    (void) p;
+
+    sorted = malloc(tm_nsyms * sizeof(*sorted));
+    if (!sorted)
+        return;
+    for (i = 0; i < tm_nsyms; i++) {
+        sorted[i] = i;
+        total += tm_funcs[i].insns;
+    }
+    qsort(sorted, tm_nsyms, sizeof(*sorted), tm_func_cmp_insns);
+
+    tm_out_printf("# Thread-Metric instruction profile: %" PRIu64
+                  " instructions\n",
+                  total);
+    tm_out_printf("# %-38s %12s %14s %10s %14s %10s %6s\n", "function",
+                  "calls", "insns", "insns/call", "incl", "incl/call", "%");
+    for (i = 0; i < tm_nsyms && tm_funcs[sorted[i]].insns; i++) {
+        struct tm_func *fn = &tm_funcs[sorted[i]];
+
+        tm_out_printf("  %-38s %12" PRIu64 " %14" PRIu64 " %10" PRIu64
+                      " %14" PRIu64 " %10" PRIu64 " %6.2f\n",
+                      tm_syms[sorted[i]].name, fn->calls, fn->insns,
+                      fn->calls ? fn->insns / fn->calls : 0, fn->incl,
+                      fn->calls ? fn->incl / fn->calls : 0,
+                      total ? 100.0 * fn->insns / total : 0.0);
+    }
+    if (tm_unknown_insns)
+        tm_out_printf("  %-38s %12s %14" PRIu64 "\n", "(no symbol)", "-",
+                      tm_unknown_insns);
+    if (tm_lost_frames)
+        tm_out_printf("# %" PRIu64 " calls deeper than %d frames not in "
+                      "inclusive counts\n",
+                      tm_lost_frames, TM_STACK_DEPTH);
+
+    tm_out_close();
+    free(sorted);
+}
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_install(qemu_plugin_id_t id,
+                                           const qemu_info_t *info,
+                                           int argc, char **argv)
+{
+    const char *syms = NULL, *out = NULL;
+    int i;
+
+    (void) info;
+    for (i = 0; i < argc; i++) {
+        if (strncmp(argv[i], "syms=", 5) == 0)
+            syms = argv[i] + 5;
+        else if (strncmp(argv[i], "out=", 4) == 0)
+            out = argv[i] + 4;
+        else {
+            fprintf(stderr, "tm_profile: unknown argument '%s'\n", argv[i]);
+            return -1;
+        }
+    }
+
+    if (!syms || tm_syms_load(syms) <= 0) {
+        fprintf(stderr, "tm_profile: need syms=<nm -S -n output>\n");
+        return -1;
+    }
+    tm_funcs = calloc(tm_nsyms, sizeof(*tm_funcs));
+    if (!tm_funcs || tm_out_open(out) != 0) {
+        fprintf(stderr, "tm_profile: cannot set up output\n");
+        return -1;
+    }
+
+    qemu_plugin_register_vcpu_tb_trans_cb(id, tm_vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, tm_plugin_exit, NULL);
+    return 0;
+}
@@ -1,5 +1,8 @@
 #!/usr/bin/env bash
-# Run a Thread-Metric ELF under QEMU mps2-an385 (Cortex-M3).
+# Run a Thread-Metric ELF under QEMU mps2-an385 (Cortex-M3), another
+# MPS2 board or the RISC-V virt machine, selected with QEMU/QEMU_MACHINE/
+# QEMU_CPU.  RISC-V builds pass "-bios none" in the extra flags so QEMU
+# starts the ELF directly in machine mode.
 #
 # Usage:
 #   scripts/qemu-run.sh <elf> [extra-qemu-flags...]
@@ -18,6 +21,31 @@
 # Environment:
 #   QEMU          -- path to qemu-system-arm (default: qemu-system-arm)
 #   QEMU_TIMEOUT  -- outer timeout in seconds (default: 120)
+#   QEMU_MACHINE  -- board (default: mps2-an385; the Makefile exports it)
+#   QEMU_CPU      -- CPU model (default: cortex-m3)
+#   QEMU_SECURE_ELF -- secure image to load next to the ELF (TrustZone
+#                    builds; the Makefile exports it).  The core boots
+#                    into it, and it enters the ELF in the Non-secure state.
+#   TM_PROFILE    -- if set, load the tm_profile TCG plugin and write a
+#                    per-function instruction profile to this file
+#   TM_CYCLES     -- if set, load the tm_cycles TCG plugin and write a
+#                    Cortex-M cycle estimate to this file
+#   TM_CYCLES_ARGS -- extra tm_cycles arguments, e.g. "cpu=m4,ws=2"
+#   TM_IRQMASK    -- if set, load the tm_irqmask TCG plugin and write the
+#                    interrupts-masked window report to this file
+#   TM_CACHE      -- if set, load the tm_cache TCG plugin and write modelled
+#                    I/D-cache misses per function to this file
+#   TM_CACHE_ARGS -- extra tm_cache arguments, e.g. "dcache=8192,dassoc=2"
+#   TM_PLUGIN_DIR -- where "make plugins" put the plugins (default:
+#                    build/plugins)
+#   NM            -- nm for the ELF's symbol map (default: arm-none-eabi-nm;
+#                    the Makefile passes the target's own)
+#   QEMU_ICOUNT   -- if set to N, run with "-icount shift=N,sleep=off":
+#                    guest time advances 2^N ns per instruction, so each
+#                    reporting interval is a fixed instruction budget and
+#                    results no longer depend on host speed.  Build with
+#                    CONFIG_QEMU_ICOUNT and the same shift so the reporter
+#                    also prints operations per million instructions.
 
 set -euo pipefail
 
@@ -31,6 +59,8 @@ shift
 
 QEMU="${QEMU:-qemu-system-arm}"
 QEMU_TIMEOUT="${QEMU_TIMEOUT:-120}"
+QEMU_MACHINE="${QEMU_MACHINE:-mps2-an385}"
+QEMU_CPU="${QEMU_CPU:-cortex-m3}"
 
 if [ ! -f "$ELF" ]; then
     echo "Error: ELF not found: $ELF" >&2
@@ -51,6 +81,7 @@ done
 qemu_pid=""
 watchdog_pid=""
 timeout_flag=""
+symbol_map=""
 
 cleanup()
 {
@@ -66,6 +97,7 @@ cleanup()
         qemu_pid=""
     fi
     [ -z "$timeout_flag" ] || rm -f "$timeout_flag"
+    [ -z "$symbol_map" ] || rm -f "$symbol_map"
 }
 
 # EXIT fires on normal exit.  INT/TERM handlers clear EXIT first to
@@ -79,10 +111,58 @@ trap 'trap - EXIT; cleanup; exit 143' TERM
 timeout_flag=$(mktemp "${TMPDIR:-/tmp}/tm-qemu-timeout.XXXXXX")
 rm -f "$timeout_flag"
 
+# Optional TCG plugins (scripts/qemu-plugins/): per-function instruction
+# profile, cycle estimate, interrupts-masked windows and cache model.
+# All read the ELF's symbol map.
+plugin_args=()
+add_plugin() {
+    local plugin="${TM_PLUGIN_DIR:-build/plugins}/lib$1.so"
+    if [ ! -f "$plugin" ]; then
+        echo "Error: plugin not found: $plugin (run 'make plugins')" >&2
+        exit 1
+    fi
+    if [ -z "$symbol_map" ]; then
+        symbol_map=$(mktemp "${TMPDIR:-/tmp}/tm-qemu-syms.XXXXXX")
+        "${NM:-arm-none-eabi-nm}" -S -n --defined-only "$ELF" > "$symbol_map"
+    fi
+    plugin_args+=(-plugin "$plugin,syms=$symbol_map,$2")
+}
+if [ -n "${TM_PROFILE:-}" ]; then
+    add_plugin tm_profile "out=$TM_PROFILE"
+fi
+if [ -n "${TM_CYCLES:-}" ]; then
+    add_plugin tm_cycles "out=$TM_CYCLES${TM_CYCLES_ARGS:+,$TM_CYCLES_ARGS}"
+fi
+if [ -n "${TM_IRQMASK:-}" ]; then
+    add_plugin tm_irqmask "out=$TM_IRQMASK"
+fi
+if [ -n "${TM_CACHE:-}" ]; then
+    add_plugin tm_cache "out=$TM_CACHE${TM_CACHE_ARGS:+,$TM_CACHE_ARGS}"
+fi
+
+# Deterministic instruction-count mode.
+icount_args=()
+if [ -n "${QEMU_ICOUNT:-}" ]; then
+    icount_args=(-icount "shift=$QEMU_ICOUNT,sleep=off")
+fi
+
+# TrustZone: the generic loader places the secure image at its Secure
+# aliases; -kernel still loads the benchmark itself.
+secure_args=()
+if [ -n "${QEMU_SECURE_ELF:-}" ]; then
+    if [ ! -f "$QEMU_SECURE_ELF" ]; then
+        echo "Error: secure image not found: $QEMU_SECURE_ELF" >&2
+        exit 1
+    fi
+    secure_args=(-device "loader,file=$QEMU_SECURE_ELF")
+fi
+
 set +e
 "$QEMU" \
-    -M mps2-an385 -cpu cortex-m3 -nographic \
-    -kernel "$ELF" "$@" 2>&1 &
+    -M "$QEMU_MACHINE" -cpu "$QEMU_CPU" -nographic \
+    ${icount_args[@]+"${icount_args[@]}"} \
+    ${secure_args[@]+"${secure_args[@]}"} \
+    -kernel "$ELF" ${plugin_args[@]+"${plugin_args[@]}"} "$@" 2>&1 &
 qemu_pid=$!
 
 # The watchdog subshell redirects its own stdout/stderr to /dev/null
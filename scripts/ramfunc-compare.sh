@@ -0,0 +1,52 @@
+#!/usr/bin/env bash
+# Compare flash- and RAM-resident kernel code on Cortex-M (mps2-an385)
+# under the tm_cycles cost model.
+#
+# Usage:
+#   scripts/ramfunc-compare.sh <threadx|freertos> [test...]
+#
+# Builds <rtos>_cortex_m_defconfig and <rtos>_cortex_m_ramfunc_defconfig
+# in turn, runs each test for one reporting interval under QEMU with the
+# tm_cycles plugin charging FLASH_WS wait states on every fetch below the
+# end of flash, and prints the estimated cycles per operation of the two
+# builds side by side with the relative change.  QEMU itself runs both
+# memories at zero wait states, so the cycle model is where the
+# difference shows.  Without test arguments it runs the scheduling,
+# message and synchronization tests.  The plugin needs QEMU 9.0 or later
+# to report per-operation figures.
+#
+# The current .config is restored on exit; build/ is rebuilt for each
+# configuration and left holding the RAM-resident build.
+#
+# Environment:
+#   FLASH_WS -- flash wait states for the cycle model (default: 2)
+# and BOARD (which also selects the M3 or M4 cost model),
+# TM_TEST_DURATION, QEMU_ICOUNT and QEMU, as described in
+# scripts/compare-lib.sh.
+
+DEFAULT_TESTS=(cooperative_scheduling preemptive_scheduling
+    message_processing synchronization_processing)
+
+# shellcheck source=scripts/compare-lib.sh
+. "$(dirname "$0")/compare-lib.sh"
+
+WS="${FLASH_WS:-2}"
+
+# Estimated cycles per operation of one run.
+measure()
+{
+    TM_CYCLES="$cycles" TM_CYCLES_ARGS="cpu=$BOARD_CPU,ws=$WS" \
+        QEMU="$QEMU" QEMU_ICOUNT="$SHIFT" scripts/qemu-run.sh "$1" \
+        -semihosting-config enable=on,target=native > /dev/null
+    awk '/^tm_cycles: interval/ {
+            for (i = 2; i <= NF; i++)
+                if ($i == "cycles/op,") v = $(i - 1)
+        } END { print v }' "$cycles"
+}
+
+compare_setup "$@"
+compare_tmpfile cycles
+compare_variant flash "${RTOS}_cortex_m_defconfig" plugins
+compare_variant ram "${RTOS}_cortex_m_ramfunc_defconfig" plugins
+compare_table "Kernel code placement, $RTOS on $QEMU_MACHINE, $WS flash wait \
+states (estimated cycles per operation)" flash flash ram RAM
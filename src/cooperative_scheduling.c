@@ -194,7 +194,7 @@ void tm_cooperative_thread_report(void)
         }
 
         /* Show the time period total. */
-        tm_printf("Time Period Total:  %lu\n\n", total - last_total);
+        tm_report_period(total - last_total);
 
         /* Save the last total. */
         last_total = total;
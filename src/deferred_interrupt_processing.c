@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2024 Microsoft Corporation
+ * SPDX-License-Identifier: MIT
+ */
+
+/* Thread-Metric Component -- Deferred Interrupt Processing Test
+ *
+ * Software trap -> ISR sends a timestamped message to a queue and
+ * resumes the worker thread -> worker preempts the interrupted thread,
+ * drains the queue and suspends itself.  This is the driver pattern of
+ * an ISR handing samples to a thread, and each report includes the
+ * end-to-end latency from the handler's send to the worker's receive.
+ */
+#include "tm_api.h"
+
+
+/* Define the counters used in the demo application... */
+
+volatile unsigned long tm_deferred_thread_0_counter;
+volatile unsigned long tm_deferred_thread_1_counter;
+volatile unsigned long tm_deferred_handler_counter;
+volatile unsigned long tm_deferred_send_errors;
+
+
+/* Define the latency accumulators, in timestamp ticks.  Written only by
+ * the worker thread; the reporter takes the sum as a running total and
+ * resets the maximum each interval.  The reporter preempts the worker,
+ * so both sides access them in a critical section: the 64-bit sum is
+ * two stores on 32-bit targets, and a reset must not land between the
+ * worker's compare and store of the maximum.
+ */
+
+volatile unsigned long long tm_deferred_latency_sum;
+volatile unsigned long tm_deferred_latency_max;
+
+
+/* Define the test thread prototypes. */
+
+void tm_deferred_thread_0_entry(void);
+void tm_deferred_thread_1_entry(void);
+
+
+/* Define the reporting thread prototype. */
+
+void tm_deferred_thread_report(void);
+
+
+/* Define the interrupt handler.  This must be called from the RTOS. */
+
+void tm_interrupt_handler(void);
+
+
+/* Define the initialization prototype. */
+
+void tm_deferred_interrupt_processing_initialize(void);
+
+
+/* Define main entry point. */
+
+void tm_main(void)
+{
+    /* Initialize the test. */
+    tm_initialize(tm_deferred_interrupt_processing_initialize);
+}
+
+
+/* Define the deferred interrupt processing test initialization. */
+
+void tm_deferred_interrupt_processing_initialize(void)
+{
+    /* Create thread that generates the interrupt at priority 10. */
+    TM_CHECK(tm_thread_create(0, 10, tm_deferred_thread_0_entry));
+
+    /* Create the worker thread at priority 5.  It stays suspended until
+     * the interrupt handler resumes it.
+     */
+    TM_CHECK(tm_thread_create(1, 5, tm_deferred_thread_1_entry));
+
+    /* Create the queue the interrupt handler sends to. */
+    TM_CHECK(tm_queue_create(0));
+
+    /* Resume just thread 0. */
+    TM_CHECK(tm_thread_resume(0));
+
+    /* Create the reporting thread. It will preempt the other
+     * threads and print out the test results.
+     */
+    TM_CHECK(tm_thread_create(5, 2, tm_deferred_thread_report));
+    TM_CHECK(tm_thread_resume(5));
+}
+
+
+/* Define the thread that generates the interrupt. */
+void tm_deferred_thread_0_entry(void)
+{
+    while (1) {
+        /* Force an interrupt. The underlying RTOS must see that the
+         * the interrupt handler is called from the appropriate software
+         * interrupt or trap.
+         */
+        tm_cause_interrupt();
+
+        /* We won't get back here until the worker has received the
+         * message and suspended itself.
+         */
+
+        /* Increment this thread's counter. */
+        tm_deferred_thread_0_counter++;
+    }
+}
+
+
+/* Define the worker thread.  Drains every queued message, records its
+ * latency and suspends until the next interrupt.
+ */
+void tm_deferred_thread_1_entry(void)
+{
+    unsigned long message[4];
+    unsigned long latency;
+
+    while (1) {
+        while (tm_queue_receive(0, message) == TM_SUCCESS) {
+            latency = tm_timestamp() - message[1];
+            tm_critical_enter();
+            tm_deferred_latency_sum += latency;
+            if (latency > tm_deferred_latency_max)
+                tm_deferred_latency_max = latency;
+            tm_critical_exit();
+
+            /* Increment this thread's counter. */
+            tm_deferred_thread_1_counter++;
+        }
+
+        /* Suspend until the next interrupt. */
+        tm_thread_suspend(1);
+    }
+}
+
+
+/* Define the interrupt handler.  This must be called from the RTOS trap
+ * handler. To be fair, it must behave just like a processor interrupt, i.e. it
+ * must save the full context of the interrupted thread during the preemption
+ * processing.
+ */
+void tm_interrupt_handler(void)
+{
+    unsigned long message[4];
+
+    /* Increment the interrupt count. */
+    tm_deferred_handler_counter++;
+
+    /* Send a sequence number and timestamp to the worker. */
+    message[0] = tm_deferred_handler_counter;
+    message[1] = tm_timestamp();
+    message[2] = 0;
+    message[3] = 0;
+    if (tm_queue_send(0, message) != TM_SUCCESS)
+        tm_deferred_send_errors++;
+
+    /* Resume the worker thread. */
+    tm_thread_resume(1);
+}
+
+
+/* Define the deferred interrupt test reporting thread. */
+void tm_deferred_thread_report(void)
+{
+    unsigned long total;
+    unsigned long last_total;
+    unsigned long relative_time;
+    unsigned long ct, cw, ch;
+    unsigned long long sum, last_sum;
+    unsigned long max, ns_per_tick;
+
+    /* Initialize the last totals. */
+    last_total = 0;
+    last_sum = 0;
+
+    /* Initialize the relative time. */
+    relative_time = 0;
+
+    /* Timestamp resolution, rounded to whole nanoseconds. */
+    ns_per_tick = 1000000000UL / tm_timestamp_frequency();
+    if (ns_per_tick == 0)
+        ns_per_tick = 1;
+
+    TM_REPORT_LOOP
+    {
+        /* Sleep to allow the test to run. */
+        tm_thread_sleep(tm_test_duration);
+
+        /* Increment the relative time. */
+        relative_time = relative_time + tm_test_duration;
+
+        /* Print results to the stdio window. */
+        tm_printf(
+            "**** Thread-Metric Deferred Interrupt Processing Test **** "
+            "Relative Time: %lu\n",
+            relative_time);
+
+        /* Snapshot counters for consistent total and tolerance check. */
+        ct = tm_deferred_thread_0_counter;
+        cw = tm_deferred_thread_1_counter;
+        ch = tm_deferred_handler_counter;
+        tm_critical_enter();
+        sum = tm_deferred_latency_sum;
+        max = tm_deferred_latency_max;
+        tm_deferred_latency_max = 0;
+        tm_critical_exit();
+
+        /* Every interrupt must reach the worker exactly once. */
+        if (ch == 0 || (cw + 1 < ch) || (cw > ch) || (ct > ch) ||
+            tm_deferred_send_errors != 0) {
+            tm_printf(
+                "ERROR: Invalid counter value(s). Deferred interrupt "
+                "processing test has failed!\n");
+        }
+
+        total = cw - last_total;
+        tm_printf("Latency (ISR send -> thread receive): avg %lu ns, "
+                  "max %lu ns\n",
+                  total ? (unsigned long) ((sum - last_sum) / total) *
+                              ns_per_tick
+                        : 0,
+                  max * ns_per_tick);
+
+        /* Show the total messages for the time period. */
+        tm_report_period(total);
+
+        /* Save the last total number of messages and latency sum. */
+        last_total = cw;
+        last_sum = sum;
+    }
+
+    TM_REPORT_FINISH;
+}
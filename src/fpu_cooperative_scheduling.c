@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2024 Microsoft Corporation
+ * SPDX-License-Identifier: MIT
+ */
+
+/* Thread-Metric Component -- FPU Cooperative Scheduling Test
+ *
+ * The Cooperative Scheduling test with floating-point work in every
+ * thread: five equal-priority threads doing round-robin relinquish, each
+ * keeping live FPU registers across its switches.  Every switch
+ * therefore saves and restores the callee-saved s16-s31 (and, through
+ * the exception frame, s0-s15), and each thread checks that its values
+ * survived.
+ */
+#include "tm_api.h"
+
+
+/* Each thread steps its accumulator from its own seed by its own step
+ * and checks it against the value its step count predicts.  The seeds'
+ * fractional parts differ, so no two threads ever hold the same value:
+ * registers swapped with another thread's, or lost, are caught.  The
+ * sequence restarts after TM_FPU_WRAP steps so it stays exact in single
+ * precision.
+ */
+
+#define TM_FPU_SEED(id) (0.125f * (float) ((id) + 1))
+#define TM_FPU_STEP(id) ((float) ((id) + 1))
+#define TM_FPU_WRAP 262144UL
+
+
+/* Define the counters used in the demo application... */
+
+volatile unsigned long tm_fpu_cooperative_thread_0_counter;
+volatile unsigned long tm_fpu_cooperative_thread_1_counter;
+volatile unsigned long tm_fpu_cooperative_thread_2_counter;
+volatile unsigned long tm_fpu_cooperative_thread_3_counter;
+volatile unsigned long tm_fpu_cooperative_thread_4_counter;
+
+
+/* Define the count of FPU state mismatches seen by the threads. */
+
+volatile unsigned long tm_fpu_cooperative_errors;
+
+
+/* Define the test thread prototypes. */
+
+void tm_fpu_cooperative_thread_0_entry(void);
+void tm_fpu_cooperative_thread_1_entry(void);
+void tm_fpu_cooperative_thread_2_entry(void);
+void tm_fpu_cooperative_thread_3_entry(void);
+void tm_fpu_cooperative_thread_4_entry(void);
+
+
+/* Define the reporting thread prototype. */
+
+void tm_fpu_cooperative_thread_report(void);
+
+
+/* Define the initialization prototype. */
+
+void tm_fpu_cooperative_initialize(void);
+
+
+/* Define main entry point. */
+
+void tm_main(void)
+{
+    /* Initialize the test. */
+    tm_initialize(tm_fpu_cooperative_initialize);
+}
+
+
+/* Define the FPU cooperative scheduling test initialization. */
+
+void tm_fpu_cooperative_initialize(void)
+{
+    /* Create all 5 threads at priority 3. */
+    TM_CHECK(tm_thread_create(0, 3, tm_fpu_cooperative_thread_0_entry));
+    TM_CHECK(tm_thread_create(1, 3, tm_fpu_cooperative_thread_1_entry));
+    TM_CHECK(tm_thread_create(2, 3, tm_fpu_cooperative_thread_2_entry));
+    TM_CHECK(tm_thread_create(3, 3, tm_fpu_cooperative_thread_3_entry));
+    TM_CHECK(tm_thread_create(4, 3, tm_fpu_cooperative_thread_4_entry));
+
+    /* Resume all 5 threads. */
+    TM_CHECK(tm_thread_resume(0));
+    TM_CHECK(tm_thread_resume(1));
+    TM_CHECK(tm_thread_resume(2));
+    TM_CHECK(tm_thread_resume(3));
+    TM_CHECK(tm_thread_resume(4));
+
+    /* Create the reporting thread. It will preempt the other
+     * threads and print out the test results.
+     */
+    TM_CHECK(tm_thread_create(5, 2, tm_fpu_cooperative_thread_report));
+    TM_CHECK(tm_thread_resume(5));
+}
+
+
+/* Define the first cooperative thread. */
+void tm_fpu_cooperative_thread_0_entry(void)
+{
+    float acc = TM_FPU_SEED(0);
+    unsigned long steps = 0;
+
+    while (1) {
+        /* Floating-point work; acc stays live in an FPU register across
+         * the context switch below.
+         */
+        acc = acc + TM_FPU_STEP(0);
+        steps++;
+
+        /* Relinquish to all other threads at same priority. */
+        tm_thread_relinquish();
+
+        /* Every other thread has used the FPU meanwhile; this thread's
+         * registers must have been saved and restored.
+         */
+        if (acc != TM_FPU_SEED(0) + (float) steps * TM_FPU_STEP(0))
+            tm_fpu_cooperative_errors++;
+        if (steps >= TM_FPU_WRAP) {
+            acc = TM_FPU_SEED(0);
+            steps = 0;
+        }
+
+        /* Increment this thread's counter. */
+        tm_fpu_cooperative_thread_0_counter++;
+    }
+}
+
+/* Define the second cooperative thread. */
+void tm_fpu_cooperative_thread_1_entry(void)
+{
+    float acc = TM_FPU_SEED(1);
+    unsigned long steps = 0;
+
+    while (1) {
+        /* Floating-point work; acc stays live in an FPU register across
+         * the context switch below.
+         */
+        acc = acc + TM_FPU_STEP(1);
+        steps++;
+
+        /* Relinquish to all other threads at same priority. */
+        tm_thread_relinquish();
+
+        /* Every other thread has used the FPU meanwhile; this thread's
+         * registers must have been saved and restored.
+         */
+        if (acc != TM_FPU_SEED(1) + (float) steps * TM_FPU_STEP(1))
+            tm_fpu_cooperative_errors++;
+        if (steps >= TM_FPU_WRAP) {
+            acc = TM_FPU_SEED(1);
+            steps = 0;
+        }
+
+        /* Increment this thread's counter. */
+        tm_fpu_cooperative_thread_1_counter++;
+    }
+}
+
+/* Define the third cooperative thread. */
+void tm_fpu_cooperative_thread_2_entry(void)
+{
+    float acc = TM_FPU_SEED(2);
+    unsigned long steps = 0;
+
+    while (1) {
+        /* Floating-point work; acc stays live in an FPU register across
+         * the context switch below.
+         */
+        acc = acc + TM_FPU_STEP(2);
+        steps++;
+
+        /* Relinquish to all other threads at same priority. */
+        tm_thread_relinquish();
+
+        /* Every other thread has used the FPU meanwhile; this thread's
+         * registers must have been saved and restored.
+         */
+        if (acc != TM_FPU_SEED(2) + (float) steps * TM_FPU_STEP(2))
+            tm_fpu_cooperative_errors++;
+        if (steps >= TM_FPU_WRAP) {
+            acc = TM_FPU_SEED(2);
+            steps = 0;
+        }
+
+        /* Increment this thread's counter. */
+        tm_fpu_cooperative_thread_2_counter++;
+    }
+}
+
+/* Define the fourth cooperative thread. */
+void tm_fpu_cooperative_thread_3_entry(void)
+{
+    float acc = TM_FPU_SEED(3);
+    unsigned long steps = 0;
+
+    while (1) {
+        /* Floating-point work; acc stays live in an FPU register across
+         * the context switch below.
+         */
+        acc = acc + TM_FPU_STEP(3);
+        steps++;
+
+        /* Relinquish to all other threads at same priority. */
+        tm_thread_relinquish();
+
+        /* Every other thread has used the FPU meanwhile; this thread's
+         * registers must have been saved and restored.
+         */
+        if (acc != TM_FPU_SEED(3) + (float) steps * TM_FPU_STEP(3))
+            tm_fpu_cooperative_errors++;
+        if (steps >= TM_FPU_WRAP) {
+            acc = TM_FPU_SEED(3);
+            steps = 0;
+        }
+
+        /* Increment this thread's counter. */
+        tm_fpu_cooperative_thread_3_counter++;
+    }
+}
+
+/* Define the fifth cooperative thread. */
+void tm_fpu_cooperative_thread_4_entry(void)
+{
+    float acc = TM_FPU_SEED(4);
+    unsigned long steps = 0;
+
+    while (1) {
+        /* Floating-point work; acc stays live in an FPU register across
+         * the context switch below.
+         */
+        acc = acc + TM_FPU_STEP(4);
+        steps++;
+
+        /* Relinquish to all other threads at same priority. */
+        tm_thread_relinquish();
+
+        /* Every other thread has used the FPU meanwhile; this thread's
+         * registers must have been saved and restored.
+         */
+        if (acc != TM_FPU_SEED(4) + (float) steps * TM_FPU_STEP(4))
+            tm_fpu_cooperative_errors++;
+        if (steps >= TM_FPU_WRAP) {
+            acc = TM_FPU_SEED(4);
+            steps = 0;
+        }
+
+        /* Increment this thread's counter. */
+        tm_fpu_cooperative_thread_4_counter++;
+    }
+}
+
+
+/* Define the FPU cooperative test reporting thread. */
+void tm_fpu_cooperative_thread_report(void)
+{
+    unsigned long total;
+    unsigned long relative_time;
+    unsigned long last_total;
+    unsigned long average;
+    unsigned long c0, c1, c2, c3, c4;
+
+    /* Initialize the last total. */
+    last_total = 0;
+
+    /* Initialize the relative time. */
+    relative_time = 0;
+
+    TM_REPORT_LOOP
+    {
+        /* Sleep to allow the test to run. */
+        tm_thread_sleep(tm_test_duration);
+
+        /* Increment the relative time. */
+        relative_time = relative_time + tm_test_duration;
+
+        /* Print results to the stdio window. */
+        tm_printf(
+            "**** Thread-Metric FPU Cooperative Scheduling Test **** Relative "
+            "Time: %lu\n",
+            relative_time);
+
+        /* Snapshot counters so the tolerance check uses values consistent with
+         * the total (workers keep incrementing).
+         */
+        c0 = tm_fpu_cooperative_thread_0_counter;
+        c1 = tm_fpu_cooperative_thread_1_counter;
+        c2 = tm_fpu_cooperative_thread_2_counter;
+        c3 = tm_fpu_cooperative_thread_3_counter;
+        c4 = tm_fpu_cooperative_thread_4_counter;
+
+        /* Calculate the total of all the counters. */
+        total = c0 + c1 + c2 + c3 + c4;
+
+        /* Calculate the average of all the counters. */
+        average = total / 5;
+
+        /* See if there are any errors. Skip when average is 0 to avoid unsigned
+         * wraparound on (average - 1).
+         */
+        if (average > 0 && ((c0 < (average - 1)) || (c0 > (average + 1)) ||
+                            (c1 < (average - 1)) || (c1 > (average + 1)) ||
+                            (c2 < (average - 1)) || (c2 > (average + 1)) ||
+                            (c3 < (average - 1)) || (c3 > (average + 1)) ||
+                            (c4 < (average - 1)) || (c4 > (average + 1)))) {
+            tm_printf(
+                "ERROR: Invalid counter value(s). Cooperative counters should "
+                "not be more that 1 different than the average!\n");
+        }
+
+        /* See if any thread lost its FPU state. */
+        if (tm_fpu_cooperative_errors != 0) {
+            tm_printf("ERROR: FPU state corrupted across a context switch "
+                      "(%lu times)!\n",
+                      tm_fpu_cooperative_errors);
+        }
+
+        /* Show the time period total. */
+        tm_report_period(total - last_total);
+
+        /* Save the last total. */
+        last_total = total;
+    }
+
+    TM_REPORT_FINISH;
+}
@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2024 Microsoft Corporation
+ * SPDX-License-Identifier: MIT
+ */
+
+/* Thread-Metric Component -- Interrupt Latency Processing Test
+ *
+ * A hardware timer raises its interrupt at pseudo-random points while
+ * three threads keep the kernel busy with queue send/receive, semaphore
+ * get/put and resume/suspend.  The handler measures how long its
+ * interrupt was pending -- mostly time spent masked inside the kernel's
+ * critical sections -- and each report shows the latency distribution.
+ * An interrupt taken only after the timer expired again has no valid
+ * latency and is reported as an overrun instead.
+ * The total is the number of kernel operations done under that load.
+ *
+ * The timer runs at a kernel-aware priority, i.e. one the kernels mask
+ * in their critical sections (PRIMASK for ThreadX, BASEPRI for
+ * FreeRTOS).
+ *
+ * Requires tm_hw_timer_start() (Cortex-M targets only).
+ */
+
+#include "tm_api.h"
+
+
+/* Interrupt spacing range in microseconds. */
+#define TM_LATENCY_PERIOD_MIN_US 50
+#define TM_LATENCY_PERIOD_MAX_US 1000
+
+/* Histogram bucket upper bounds in microseconds; the last bucket takes
+ * everything above.
+ */
+#define TM_LATENCY_BUCKETS 7
+
+static const unsigned long tm_latency_bound_us[TM_LATENCY_BUCKETS - 1] = {
+    1, 2, 5, 10, 20, 50};
+
+
+/* Define the counters used in the demo application... */
+
+volatile unsigned long tm_latency_queue_counter;
+volatile unsigned long tm_latency_semaphore_counter;
+volatile unsigned long tm_latency_resume_counter;
+volatile unsigned long tm_latency_interrupt_counter;
+volatile unsigned long tm_latency_overrun_counter;
+
+
+/* Define the latency statistics, in timestamp ticks.  Counts and sum are
+ * running totals; the reporter resets the extremes each interval.
+ */
+
+volatile unsigned long tm_latency_histogram[TM_LATENCY_BUCKETS];
+volatile unsigned long long tm_latency_sum;
+volatile unsigned long tm_latency_min;
+volatile unsigned long tm_latency_max;
+
+static unsigned long tm_latency_bound[TM_LATENCY_BUCKETS - 1];
+static unsigned long tm_latency_ticks_per_us;
+static unsigned long tm_latency_seed = 12345;
+
+
+/* Define the test thread prototypes. */
+
+void tm_latency_queue_thread_entry(void);
+void tm_latency_semaphore_thread_entry(void);
+void tm_latency_resume_thread_entry(void);
+void tm_latency_suspend_thread_entry(void);
+
+
+/* Define the reporting thread prototype. */
+
+void tm_latency_thread_report(void);
+
+
+/* Define the initialization prototype. */
+
+void tm_interrupt_latency_processing_initialize(void);
+
+
+/* Define main entry point. */
+
+void tm_main(void)
+{
+    /* Initialize the test. */
+    tm_initialize(tm_interrupt_latency_processing_initialize);
+}
+
+
+/* Define the interrupt latency processing test initialization. */
+
+void tm_interrupt_latency_processing_initialize(void)
+{
+    int i;
+
+    /* Convert the histogram bounds to timestamp ticks. */
+    tm_latency_ticks_per_us = tm_timestamp_frequency() / 1000000UL;
+    for (i = 0; i < TM_LATENCY_BUCKETS - 1; i++)
+        tm_latency_bound[i] = tm_latency_bound_us[i] * tm_latency_ticks_per_us;
+    tm_latency_min = ~0UL;
+
+    /* Create the load threads at the same priority; they take turns by
+     * relinquishing after every operation.
+     */
+    TM_CHECK(tm_thread_create(0, 10, tm_latency_queue_thread_entry));
+    TM_CHECK(tm_thread_create(1, 10, tm_latency_semaphore_thread_entry));
+    TM_CHECK(tm_thread_create(2, 10, tm_latency_resume_thread_entry));
+
+    /* Create the thread resumed by thread 2 at priority 5. */
+    TM_CHECK(tm_thread_create(3, 5, tm_latency_suspend_thread_entry));
+
+    TM_CHECK(tm_queue_create(0));
+    TM_CHECK(tm_semaphore_create(0));
+
+    /* Resume the load threads. */
+    TM_CHECK(tm_thread_resume(0));
+    TM_CHECK(tm_thread_resume(1));
+    TM_CHECK(tm_thread_resume(2));
+
+    /* Create the reporting thread. It will preempt the other
+     * threads and print out the test results.
+     */
+    TM_CHECK(tm_thread_create(5, 2, tm_latency_thread_report));
+    TM_CHECK(tm_thread_resume(5));
+}
+
+
+/* Define the queue load thread. */
+void tm_latency_queue_thread_entry(void)
+{
+    unsigned long message[4] = {0x11112222, 0x33334444, 0x55556666,
+                                0x77778888};
+
+    while (1) {
+        tm_queue_send(0, message);
+        tm_queue_receive(0, message);
+
+        /* Increment this thread's counter. */
+        tm_latency_queue_counter++;
+
+        tm_thread_relinquish();
+    }
+}
+
+
+/* Define the semaphore load thread. */
+void tm_latency_semaphore_thread_entry(void)
+{
+    while (1) {
+        tm_semaphore_get(0);
+        tm_semaphore_put(0);
+
+        /* Increment this thread's counter. */
+        tm_latency_semaphore_counter++;
+
+        tm_thread_relinquish();
+    }
+}
+
+
+/* Define the resume/suspend load thread. */
+void tm_latency_resume_thread_entry(void)
+{
+    while (1) {
+        /* Resume thread 3, which preempts and suspends itself. */
+        tm_thread_resume(3);
+
+        /* Increment this thread's counter. */
+        tm_latency_resume_counter++;
+
+        tm_thread_relinquish();
+    }
+}
+
+
+/* Define the thread resumed by the resume/suspend load thread. */
+void tm_latency_suspend_thread_entry(void)
+{
+    while (1)
+        tm_thread_suspend(3);
+}
+
+
+/* Define the hardware timer interrupt handler. */
+void tm_hw_timer_handler(void)
+{
+    unsigned long latency;
+    int i;
+
+    /* An interrupt taken after the timer expired again has no valid
+     * latency; count it apart so it stays out of the statistics.
+     */
+    if (tm_hw_timer_latency(&latency) != TM_SUCCESS) {
+        tm_latency_overrun_counter++;
+    } else {
+        /* Increment the interrupt count. */
+        tm_latency_interrupt_counter++;
+
+        for (i = 0; i < TM_LATENCY_BUCKETS - 1; i++)
+            if (latency < tm_latency_bound[i])
+                break;
+        tm_latency_histogram[i]++;
+        tm_latency_sum += latency;
+        if (latency < tm_latency_min)
+            tm_latency_min = latency;
+        if (latency > tm_latency_max)
+            tm_latency_max = latency;
+    }
+
+    /* Pick a pseudo-random arrival point for the next interrupt so it
+     * lands at a different place in the load threads' loops.
+     */
+    tm_latency_seed = tm_latency_seed * 1103515245UL + 12345UL;
+    tm_hw_timer_set_next_period(
+        (TM_LATENCY_PERIOD_MIN_US +
+         (tm_latency_seed >> 16) %
+             (TM_LATENCY_PERIOD_MAX_US - TM_LATENCY_PERIOD_MIN_US)) *
+        tm_latency_ticks_per_us);
+}
+
+
+/* Print a latency in timestamp ticks as microseconds with two decimals. */
+static void tm_latency_print_us(const char *label, unsigned long ticks)
+{
+    unsigned long hundredths;
+
+    hundredths = ticks * 100UL / tm_latency_ticks_per_us;
+    tm_printf("%s ", label);
+    tm_print_fixed2(hundredths);
+    tm_printf(" us");
+}
+
+
+/* Define the interrupt latency test reporting thread. */
+void tm_latency_thread_report(void)
+{
+    unsigned long total, last_total;
+    unsigned long relative_time;
+    unsigned long interrupts, last_interrupts;
+    unsigned long overruns, last_overruns;
+    unsigned long histogram[TM_LATENCY_BUCKETS];
+    unsigned long last_histogram[TM_LATENCY_BUCKETS];
+    unsigned long long sum, last_sum;
+    unsigned long min, max, count;
+    int i;
+
+    /* Initialize the last totals. */
+    last_total = 0;
+    last_interrupts = 0;
+    last_overruns = 0;
+    last_sum = 0;
+    for (i = 0; i < TM_LATENCY_BUCKETS; i++)
+        last_histogram[i] = 0;
+
+    /* Initialize the relative time. */
+    relative_time = 0;
+
+    /* Start the interrupt source; later periods are randomized. */
+    if (tm_hw_timer_start(1000000UL / TM_LATENCY_PERIOD_MAX_US) != TM_SUCCESS)
+        tm_check_fail("FATAL: tm_hw_timer_start failed\n");
+
+    TM_REPORT_LOOP
+    {
+        /* Sleep to allow the test to run. */
+        tm_thread_sleep(tm_test_duration);
+
+        /* Stop the timer before reporting: console output can stall
+         * the CPU (semihosting) and would show up as latency.
+         */
+        tm_hw_timer_stop();
+
+        /* Increment the relative time. */
+        relative_time = relative_time + tm_test_duration;
+
+        /* Print results to the stdio window. */
+        tm_printf(
+            "**** Thread-Metric Interrupt Latency Test **** Relative Time: "
+            "%lu\n",
+            relative_time);
+
+        interrupts = tm_latency_interrupt_counter;
+        overruns = tm_latency_overrun_counter;
+        sum = tm_latency_sum;
+        min = tm_latency_min;
+        max = tm_latency_max;
+        for (i = 0; i < TM_LATENCY_BUCKETS; i++)
+            histogram[i] = tm_latency_histogram[i];
+        tm_latency_min = ~0UL;
+        tm_latency_max = 0;
+        total = tm_latency_queue_counter + tm_latency_semaphore_counter +
+                tm_latency_resume_counter;
+
+        count = interrupts - last_interrupts;
+
+        /* See if there are any errors. */
+        if (count == 0 || total == last_total) {
+            tm_printf(
+                "ERROR: Invalid counter value(s). Interrupt latency test has "
+                "failed!\n");
+        }
+
+        tm_printf("Interrupts: %lu, latency", count);
+        if (count) {
+            tm_latency_print_us(" min", min);
+            tm_latency_print_us(", avg",
+                                (unsigned long) ((sum - last_sum) / count));
+            tm_latency_print_us(", max", max);
+        } else {
+            tm_printf(" n/a");
+        }
+        tm_printf(", overruns %lu", overruns - last_overruns);
+        tm_printf("\nLatency histogram:");
+        for (i = 0; i < TM_LATENCY_BUCKETS; i++) {
+            if (i < TM_LATENCY_BUCKETS - 1)
+                tm_printf(" <%lu us: %lu", tm_latency_bound_us[i],
+                          histogram[i] - last_histogram[i]);
+            else
+                tm_printf(" >=%lu us: %lu\n", tm_latency_bound_us[i - 1],
+                          histogram[i] - last_histogram[i]);
+            last_histogram[i] = histogram[i];
+        }
+
+        /* Show the kernel operations for the time period. */
+        tm_report_period(total - last_total);
+
+        /* Save the last totals. */
+        last_total = total;
+        last_interrupts = interrupts;
+        last_overruns = overruns;
+        last_sum = sum;
+
+        /* Restart the interrupt source for the next interval. */
+        if (tm_hw_timer_start(1000000UL / TM_LATENCY_PERIOD_MAX_US) !=
+            TM_SUCCESS)
+            tm_check_fail("FATAL: tm_hw_timer_start failed\n");
+    }
+
+    TM_REPORT_FINISH;
+}
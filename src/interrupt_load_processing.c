@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2024 Microsoft Corporation
+ * SPDX-License-Identifier: MIT
+ */
+
+/* Thread-Metric Component -- Interrupt Load Processing Test
+ *
+ * A hardware timer fires a periodic interrupt while a background thread
+ * runs the basic-processing workload.  Each interrupt resumes a
+ * higher-priority thread, which counts the delivery and suspends again.
+ * The first interval runs without the timer to establish a baseline, so
+ * every report shows the throughput lost to interrupt load and the
+ * fraction of interrupts that reached their thread.
+ *
+ * Requires tm_hw_timer_start() (Cortex-M targets only).
+ */
+
+#include "tm_api.h"
+
+/* Interrupt rate in Hz. */
+#ifndef TM_HW_TIMER_IRQ_HZ
+#define TM_HW_TIMER_IRQ_HZ 1000
+#endif
+
+
+/* Define the counters used in the demo application... */
+
+volatile unsigned long tm_interrupt_load_thread_0_counter;
+volatile unsigned long tm_interrupt_load_work_counter;
+volatile unsigned long tm_interrupt_load_handler_counter;
+
+
+/* Define the workload array. */
+
+volatile unsigned long tm_interrupt_load_array[1024];
+
+
+/* Define the test thread prototypes. */
+
+void tm_interrupt_load_thread_0_entry(void);
+void tm_interrupt_load_thread_1_entry(void);
+
+
+/* Define the reporting thread prototype. */
+
+void tm_interrupt_load_thread_report(void);
+
+
+/* Define the initialization prototype. */
+
+void tm_interrupt_load_processing_initialize(void);
+
+
+/* Define main entry point. */
+
+void tm_main(void)
+{
+    /* Initialize the test. */
+    tm_initialize(tm_interrupt_load_processing_initialize);
+}
+
+
+/* Define the interrupt load processing test initialization. */
+
+void tm_interrupt_load_processing_initialize(void)
+{
+    /* Create the interrupt-driven thread at priority 3.  It stays
+     * suspended until the timer interrupt resumes it.
+     */
+    TM_CHECK(tm_thread_create(0, 3, tm_interrupt_load_thread_0_entry));
+
+    /* Create the background workload thread at priority 10. */
+    TM_CHECK(tm_thread_create(1, 10, tm_interrupt_load_thread_1_entry));
+
+    /* Resume just thread 1. */
+    TM_CHECK(tm_thread_resume(1));
+
+    /* Create the reporting thread. It will preempt the other
+     * threads and print out the test results.
+     */
+    TM_CHECK(tm_thread_create(5, 2, tm_interrupt_load_thread_report));
+    TM_CHECK(tm_thread_resume(5));
+}
+
+
+/* Define the interrupt-driven thread.  Resumed from the timer interrupt
+ * handler, it counts the delivery and suspends itself.
+ */
+void tm_interrupt_load_thread_0_entry(void)
+{
+    while (1) {
+        /* Increment this thread's counter. */
+        tm_interrupt_load_thread_0_counter++;
+
+        /* Suspend until the next interrupt. */
+        tm_thread_suspend(0);
+    }
+}
+
+
+/* Define the background workload thread (same work as Basic Processing). */
+void tm_interrupt_load_thread_1_entry(void)
+{
+    int i;
+    unsigned long counter_snapshot;
+
+    /* Initialize the test array. */
+    for (i = 0; i < 1024; i++)
+        tm_interrupt_load_array[i] = 0;
+
+    while (1) {
+        counter_snapshot = tm_interrupt_load_work_counter;
+
+        for (i = 0; i < 1024; i++) {
+            tm_interrupt_load_array[i] =
+                (tm_interrupt_load_array[i] + counter_snapshot) ^
+                tm_interrupt_load_array[i];
+        }
+
+        /* Increment the workload counter. */
+        tm_interrupt_load_work_counter++;
+    }
+}
+
+
+/* Define the hardware timer interrupt handler. */
+void tm_hw_timer_handler(void)
+{
+    /* Increment the interrupt count. */
+    tm_interrupt_load_handler_counter++;
+
+    /* Resume the interrupt-driven thread. */
+    tm_thread_resume(0);
+}
+
+
+/* Print num / den as a percentage with one decimal, without overflowing
+ * a 32-bit unsigned long.
+ */
+static void tm_interrupt_load_print_percent(unsigned long num,
+                                            unsigned long den)
+{
+    unsigned long permille;
+
+    if (den == 0)
+        permille = 0;
+    else if (den > 4000000UL)
+        permille = num / (den / 1000);
+    else
+        permille = num * 1000UL / den;
+    tm_printf("%lu.%lu%%", permille / 10, permille % 10);
+}
+
+
+/* Define the interrupt load test reporting thread. */
+void tm_interrupt_load_thread_report(void)
+{
+    unsigned long baseline;
+    unsigned long relative_time;
+    unsigned long work, handled, delivered;
+    unsigned long last_work, last_handled, last_delivered;
+    unsigned long work_delta, handled_delta, delivered_delta;
+
+    /* Measure one interval without interrupt load. */
+    tm_thread_sleep(tm_test_duration);
+    baseline = tm_interrupt_load_work_counter;
+    tm_printf("Interrupt load baseline (no timer): %lu\n", baseline);
+
+    /* Start the interrupt source. */
+    if (tm_hw_timer_start(TM_HW_TIMER_IRQ_HZ) != TM_SUCCESS)
+        tm_check_fail("FATAL: tm_hw_timer_start failed\n");
+
+    /* Initialize the last counters. */
+    last_work = tm_interrupt_load_work_counter;
+    last_handled = tm_interrupt_load_handler_counter;
+    last_delivered = tm_interrupt_load_thread_0_counter;
+
+    /* Initialize the relative time. */
+    relative_time = 0;
+
+    TM_REPORT_LOOP
+    {
+        /* Sleep to allow the test to run. */
+        tm_thread_sleep(tm_test_duration);
+
+        /* Increment the relative time. */
+        relative_time = relative_time + tm_test_duration;
+
+        /* Print results to the stdio window. */
+        tm_printf(
+            "**** Thread-Metric Interrupt Load Test **** Relative Time: %lu\n",
+            relative_time);
+
+        /* Snapshot counters for a consistent report. */
+        work = tm_interrupt_load_work_counter;
+        handled = tm_interrupt_load_handler_counter;
+        delivered = tm_interrupt_load_thread_0_counter;
+
+        work_delta = work - last_work;
+        handled_delta = handled - last_handled;
+        delivered_delta = delivered - last_delivered;
+
+        /* See if there are any errors. */
+        if (handled_delta == 0 || work_delta == 0) {
+            tm_printf(
+                "ERROR: Invalid counter value(s). Interrupt load test has "
+                "failed!\n");
+        }
+
+        tm_printf("Interrupts: %lu at %d Hz, delivered to thread: %lu (",
+                  handled_delta, TM_HW_TIMER_IRQ_HZ, delivered_delta);
+        tm_interrupt_load_print_percent(delivered_delta, handled_delta);
+        tm_printf(")\nThroughput lost to interrupt load: ");
+        tm_interrupt_load_print_percent(
+            baseline > work_delta ? baseline - work_delta : 0, baseline);
+        tm_printf("\n");
+
+        /* Show the workload total for the time period. */
+        tm_report_period(work_delta);
+
+        /* Save the last counters. */
+        last_work = work;
+        last_handled = handled;
+        last_delivered = delivered;
+    }
+
+    TM_REPORT_FINISH;
+}
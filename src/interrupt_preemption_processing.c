@@ -174,7 +174,7 @@ void tm_interrupt_preemption_thread_report(void)
         }
 
         /* Show the total interrupts for the time period. */
-        tm_printf("Time Period Total:  %lu\n\n", ch - last_total);
+        tm_report_period(ch - last_total);
 
         /* Save the last total number of interrupts. */
         last_total = ch;
@@ -123,8 +123,7 @@ void tm_memory_allocation_thread_report(void)
         }
 
         /* Show the time period total. */
-        tm_printf("Time Period Total:  %lu\n\n",
-                  tm_memory_allocation_counter - last_counter);
+        tm_report_period(tm_memory_allocation_counter - last_counter);
 
         /* Save the last counter. */
         last_counter = tm_memory_allocation_counter;
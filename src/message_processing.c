@@ -128,8 +128,7 @@ void tm_message_processing_thread_report(void)
         }
 
         /* Show the time period total. */
-        tm_printf("Time Period Total:  %lu\n\n",
-                  tm_message_processing_counter - last_counter);
+        tm_report_period(tm_message_processing_counter - last_counter);
 
         /* Save the last counter. */
         last_counter = tm_message_processing_counter;
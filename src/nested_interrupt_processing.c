@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2024 Microsoft Corporation
+ * SPDX-License-Identifier: MIT
+ */
+
+/* Thread-Metric Component -- Nested Interrupt Processing Test
+ *
+ * Software IRQ (low priority) -> its handler raises a high-priority IRQ
+ * -> nested handler resumes a higher-priority thread -> preemption once
+ * both handlers have returned.  Every handler and thread also checks
+ * that the kernel's view of interrupt context (tm_isr_context()) and
+ * the nesting depth are what the hardware state says they should be.
+ *
+ * Requires tm_cause_nested_interrupt() (Cortex-M targets only).
+ */
+
+#include "tm_api.h"
+
+
+/* Define the counters used in the demo application... */
+
+volatile unsigned long tm_nested_thread_0_counter;
+volatile unsigned long tm_nested_thread_1_counter;
+volatile unsigned long tm_nested_low_counter;
+volatile unsigned long tm_nested_high_counter;
+
+
+/* Define the error counters: wrong kernel interrupt state or depth, and
+ * high-priority interrupts that did not preempt the low handler.
+ */
+
+volatile unsigned long tm_nested_bookkeeping_errors;
+volatile unsigned long tm_nested_not_nested;
+
+
+/* Define the test thread prototypes. */
+
+void tm_nested_thread_0_entry(void);
+void tm_nested_thread_1_entry(void);
+
+
+/* Define the reporting thread prototype. */
+
+void tm_nested_thread_report(void);
+
+
+/* Define the interrupt handler.  This must be called from the RTOS. */
+
+void tm_nested_interrupt_handler(int level);
+
+
+/* Define the initialization prototype. */
+
+void tm_nested_interrupt_processing_initialize(void);
+
+
+/* Define main entry point. */
+
+void tm_main(void)
+{
+    /* Initialize the test. */
+    tm_initialize(tm_nested_interrupt_processing_initialize);
+}
+
+
+/* Define the nested interrupt processing test initialization. */
+
+void tm_nested_interrupt_processing_initialize(void)
+{
+    /* Create interrupt thread at priority 3. */
+    TM_CHECK(tm_thread_create(0, 3, tm_nested_thread_0_entry));
+
+    /* Create thread that generates the interrupt at priority 10. */
+    TM_CHECK(tm_thread_create(1, 10, tm_nested_thread_1_entry));
+
+    /* Resume just thread 1. */
+    TM_CHECK(tm_thread_resume(1));
+
+    /* Create the reporting thread. It will preempt the other
+     * threads and print out the test results.
+     */
+    TM_CHECK(tm_thread_create(5, 2, tm_nested_thread_report));
+    TM_CHECK(tm_thread_resume(5));
+}
+
+
+/* Define the interrupt thread.  This thread is resumed from the nested
+ * interrupt handler.  It runs and suspends.
+ */
+void tm_nested_thread_0_entry(void)
+{
+    while (1) {
+        /* The kernel must be back in thread context. */
+        if (tm_isr_context())
+            tm_nested_bookkeeping_errors++;
+
+        /* Increment this thread's counter. */
+        tm_nested_thread_0_counter++;
+
+        /* Suspend.  This will allow the thread generating the
+         * interrupt to run again.
+         */
+        tm_thread_suspend(0);
+    }
+}
+
+
+/* Define the thread that generates the interrupt. */
+void tm_nested_thread_1_entry(void)
+{
+    while (1) {
+        /* Raise the low-priority interrupt.  Both handlers and thread 0
+         * have run by the time this returns.
+         */
+        tm_cause_nested_interrupt(TM_NESTED_LOW);
+
+        if (tm_isr_context())
+            tm_nested_bookkeeping_errors++;
+
+        /* Increment this thread's counter. */
+        tm_nested_thread_1_counter++;
+    }
+}
+
+
+/* Define the interrupt handler for both levels. */
+void tm_nested_interrupt_handler(int level)
+{
+    unsigned long high_before;
+
+    if (level == TM_NESTED_LOW) {
+        /* Increment the low-priority interrupt count. */
+        tm_nested_low_counter++;
+
+        if (!tm_isr_context() || tm_nested_interrupt_depth() != 1)
+            tm_nested_bookkeeping_errors++;
+
+        /* Raise the high-priority interrupt; it must run before the
+         * pend returns.
+         */
+        high_before = tm_nested_high_counter;
+        tm_cause_nested_interrupt(TM_NESTED_HIGH);
+        if (tm_nested_high_counter == high_before)
+            tm_nested_not_nested++;
+    } else {
+        /* Increment the high-priority interrupt count. */
+        tm_nested_high_counter++;
+
+        if (!tm_isr_context() || tm_nested_interrupt_depth() != 2)
+            tm_nested_bookkeeping_errors++;
+
+        /* Resume the higher-priority thread.  The switch is taken when
+         * the outer handler returns.
+         */
+        tm_thread_resume(0);
+    }
+}
+
+
+/* Define the nested interrupt test reporting thread. */
+void tm_nested_thread_report(void)
+{
+    unsigned long last_total;
+    unsigned long relative_time;
+    unsigned long c0, c1, cl, ch;
+
+    /* Initialize the last total. */
+    last_total = 0;
+
+    /* Initialize the relative time. */
+    relative_time = 0;
+
+    TM_REPORT_LOOP
+    {
+        /* Sleep to allow the test to run. */
+        tm_thread_sleep(tm_test_duration);
+
+        /* Increment the relative time. */
+        relative_time = relative_time + tm_test_duration;
+
+        /* Print results to the stdio window. */
+        tm_printf(
+            "**** Thread-Metric Nested Interrupt Processing Test **** "
+            "Relative Time: %lu\n",
+            relative_time);
+
+        /* Snapshot counters for a consistent tolerance check. */
+        c0 = tm_nested_thread_0_counter;
+        c1 = tm_nested_thread_1_counter;
+        cl = tm_nested_low_counter;
+        ch = tm_nested_high_counter;
+
+        /* Every low interrupt nests exactly one high interrupt, which
+         * wakes thread 0 once.
+         */
+        if (ch == 0 || cl != ch || (c0 + 1 < ch) || (c0 > ch) ||
+            (c1 > ch) || tm_nested_bookkeeping_errors != 0 ||
+            tm_nested_not_nested != 0) {
+            tm_printf("ERROR: Invalid counter value(s). Nested interrupt "
+                      "test has failed! (bookkeeping errors: %lu, "
+                      "not nested: %lu)\n",
+                      tm_nested_bookkeeping_errors, tm_nested_not_nested);
+        }
+
+        /* Show the nested interrupt entries for the time period. */
+        tm_report_period(ch - last_total);
+
+        /* Save the last total number of nested interrupts. */
+        last_total = ch;
+    }
+
+    TM_REPORT_FINISH;
+}
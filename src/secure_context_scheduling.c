@@ -0,0 +1,310 @@
+/*
+ * Copyright (c) 2024 Microsoft Corporation
+ * SPDX-License-Identifier: MIT
+ */
+
+/* Thread-Metric Component -- Secure Context Scheduling Test
+ *
+ * The Preemptive Scheduling test on a TrustZone build: five Non-secure
+ * threads at different priorities doing resume/suspend chains, each
+ * owning a secure stack and calling the secure stub on every
+ * activation.  Every switch therefore saves the outgoing thread's
+ * secure context and restores the incoming one's through the kernel's
+ * secure context manager.  The time each thread took to allocate its
+ * secure context is reported with the first interval.
+ */
+#include "tm_api.h"
+
+
+/* Define the counters used in the demo application... */
+
+volatile unsigned long tm_secure_thread_0_counter;
+volatile unsigned long tm_secure_thread_1_counter;
+volatile unsigned long tm_secure_thread_2_counter;
+volatile unsigned long tm_secure_thread_3_counter;
+volatile unsigned long tm_secure_thread_4_counter;
+
+
+/* Define the secure context allocation statistics and the count of
+ * secure calls that returned a wrong value or contexts that could not
+ * be allocated.
+ */
+
+volatile unsigned long tm_secure_allocations;
+volatile unsigned long tm_secure_allocation_ticks;
+volatile unsigned long tm_secure_errors;
+
+
+/* Define the test thread prototypes. */
+
+void tm_secure_thread_0_entry(void);
+void tm_secure_thread_1_entry(void);
+void tm_secure_thread_2_entry(void);
+void tm_secure_thread_3_entry(void);
+void tm_secure_thread_4_entry(void);
+
+
+/* Define the reporting thread prototype. */
+
+void tm_secure_thread_report(void);
+
+
+/* Define the initialization prototype. */
+
+void tm_secure_context_scheduling_initialize(void);
+
+
+/* Define main entry point. */
+
+void tm_main(void)
+{
+    /* Initialize the test. */
+    tm_initialize(tm_secure_context_scheduling_initialize);
+}
+
+
+/* Define the secure context scheduling test initialization. */
+
+void tm_secure_context_scheduling_initialize(void)
+{
+    /* Create thread 0 at priority 10. */
+    TM_CHECK(tm_thread_create(0, 10, tm_secure_thread_0_entry));
+
+    /* Create thread 1 at priority 9. */
+    TM_CHECK(tm_thread_create(1, 9, tm_secure_thread_1_entry));
+
+    /* Create thread 2 at priority 8. */
+    TM_CHECK(tm_thread_create(2, 8, tm_secure_thread_2_entry));
+
+    /* Create thread 3 at priority 7. */
+    TM_CHECK(tm_thread_create(3, 7, tm_secure_thread_3_entry));
+
+    /* Create thread 4 at priority 6. */
+    TM_CHECK(tm_thread_create(4, 6, tm_secure_thread_4_entry));
+
+    /* Resume just thread 0. */
+    TM_CHECK(tm_thread_resume(0));
+
+    /* Create the reporting thread. It will preempt the other
+     * threads and print out the test results.
+     */
+    TM_CHECK(tm_thread_create(5, 2, tm_secure_thread_report));
+    TM_CHECK(tm_thread_resume(5));
+}
+
+
+/* Allocate the calling thread's secure context, timing the request. */
+static void tm_secure_thread_setup(void)
+{
+    unsigned long start;
+
+    start = tm_timestamp();
+    if (tm_secure_context_allocate() != TM_SUCCESS)
+        tm_secure_errors++;
+    tm_secure_allocation_ticks += tm_timestamp() - start;
+    tm_secure_allocations++;
+}
+
+/* Call the secure stub and check the round trip. */
+static void tm_secure_thread_call(unsigned long value)
+{
+    if (tm_secure_call(value) != value + 1)
+        tm_secure_errors++;
+}
+
+
+/* Define the first secure thread. */
+void tm_secure_thread_0_entry(void)
+{
+    tm_secure_thread_setup();
+
+    while (1) {
+        /* Enter the secure world. */
+        tm_secure_thread_call(tm_secure_thread_0_counter);
+
+        /* Resume thread 1. */
+        tm_thread_resume(1);
+
+        /* We won't get back here until threads 1, 2, 3, and 4 all execute
+         * and self-suspend.
+         */
+
+        /* Increment this thread's counter. */
+        tm_secure_thread_0_counter++;
+    }
+}
+
+/* Define the second secure thread. */
+void tm_secure_thread_1_entry(void)
+{
+    tm_secure_thread_setup();
+
+    while (1) {
+        /* Enter the secure world. */
+        tm_secure_thread_call(tm_secure_thread_1_counter);
+
+        /* Resume thread 2. */
+        tm_thread_resume(2);
+
+        /* We won't get back here until threads 2, 3, and 4 all execute
+         * and self-suspend.
+         */
+
+        /* Increment this thread's counter. */
+        tm_secure_thread_1_counter++;
+
+        /* Suspend self! */
+        tm_thread_suspend(1);
+    }
+}
+
+/* Define the third secure thread. */
+void tm_secure_thread_2_entry(void)
+{
+    tm_secure_thread_setup();
+
+    while (1) {
+        /* Enter the secure world. */
+        tm_secure_thread_call(tm_secure_thread_2_counter);
+
+        /* Resume thread 3. */
+        tm_thread_resume(3);
+
+        /* We won't get back here until threads 3 and 4 execute and
+         * self-suspend.
+         */
+
+        /* Increment this thread's counter. */
+        tm_secure_thread_2_counter++;
+
+        /* Suspend self! */
+        tm_thread_suspend(2);
+    }
+}
+
+/* Define the fourth secure thread. */
+void tm_secure_thread_3_entry(void)
+{
+    tm_secure_thread_setup();
+
+    while (1) {
+        /* Enter the secure world. */
+        tm_secure_thread_call(tm_secure_thread_3_counter);
+
+        /* Resume thread 4. */
+        tm_thread_resume(4);
+
+        /* We won't get back here until thread 4 executes and
+         * self-suspends.
+         */
+
+        /* Increment this thread's counter. */
+        tm_secure_thread_3_counter++;
+
+        /* Suspend self! */
+        tm_thread_suspend(3);
+    }
+}
+
+/* Define the fifth secure thread. */
+void tm_secure_thread_4_entry(void)
+{
+    tm_secure_thread_setup();
+
+    while (1) {
+        /* Enter the secure world. */
+        tm_secure_thread_call(tm_secure_thread_4_counter);
+
+        /* Increment this thread's counter. */
+        tm_secure_thread_4_counter++;
+
+        /* Self suspend thread 4. */
+        tm_thread_suspend(4);
+    }
+}
+
+
+/* Define the secure context scheduling test reporting thread. */
+void tm_secure_thread_report(void)
+{
+    unsigned long total;
+    unsigned long relative_time;
+    unsigned long last_total;
+    unsigned long average;
+    unsigned long c0, c1, c2, c3, c4;
+
+    /* Initialize the last total. */
+    last_total = 0;
+
+    /* Initialize the relative time. */
+    relative_time = 0;
+
+    TM_REPORT_LOOP
+    {
+        /* Sleep to allow the test to run. */
+        tm_thread_sleep(tm_test_duration);
+
+        /* Increment the relative time. */
+        relative_time = relative_time + tm_test_duration;
+
+        /* Print results to the stdio window. */
+        tm_printf(
+            "**** Thread-Metric Secure Context Scheduling Test **** Relative "
+            "Time: %lu\n",
+            relative_time);
+
+        /* All five threads allocate before their first switch, so the
+         * figures are complete by the first report.
+         */
+        if (relative_time == (unsigned long) tm_test_duration &&
+            tm_secure_allocations != 0) {
+            tm_printf("Secure context allocation: %lu ticks average over "
+                      "%lu threads (%lu Hz)\n",
+                      tm_secure_allocation_ticks / tm_secure_allocations,
+                      tm_secure_allocations, tm_timestamp_frequency());
+        }
+
+        /* Snapshot counters so the tolerance check uses values consistent with
+         * the total (workers keep incrementing).
+         */
+        c0 = tm_secure_thread_0_counter;
+        c1 = tm_secure_thread_1_counter;
+        c2 = tm_secure_thread_2_counter;
+        c3 = tm_secure_thread_3_counter;
+        c4 = tm_secure_thread_4_counter;
+
+        /* Calculate the total of all the counters. */
+        total = c0 + c1 + c2 + c3 + c4;
+
+        /* Calculate the average of all the counters. */
+        average = total / 5;
+
+        /* See if there are any errors. Skip when average is 0 to avoid unsigned
+         * wraparound on (average - 1).
+         */
+        if (average > 0 && ((c0 < (average - 1)) || (c0 > (average + 1)) ||
+                            (c1 < (average - 1)) || (c1 > (average + 1)) ||
+                            (c2 < (average - 1)) || (c2 > (average + 1)) ||
+                            (c3 < (average - 1)) || (c3 > (average + 1)) ||
+                            (c4 < (average - 1)) || (c4 > (average + 1)))) {
+            tm_printf(
+                "ERROR: Invalid counter value(s). Secure counters should "
+                "not be more that 1 different than the average!\n");
+        }
+
+        /* See if a secure call or context allocation failed. */
+        if (tm_secure_errors != 0) {
+            tm_printf("ERROR: Secure call or context allocation failed "
+                      "(%lu times)!\n",
+                      tm_secure_errors);
+        }
+
+        /* Show the time period total. */
+        tm_report_period(total - last_total);
+
+        /* Save the last total. */
+        last_total = total;
+    }
+
+    TM_REPORT_FINISH;
+}
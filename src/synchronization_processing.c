@@ -123,8 +123,7 @@ void tm_synchronization_processing_thread_report(void)
         }
 
         /* Show the time period total. */
-        tm_printf("Time Period Total:  %lu\n\n",
-                  tm_synchronization_processing_counter - last_counter);
+        tm_report_period(tm_synchronization_processing_counter - last_counter);
 
         /* Save the last counter. */
         last_counter = tm_synchronization_processing_counter;
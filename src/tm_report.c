@@ -7,7 +7,8 @@
  *
  * Provides tm_printf() so test sources need no libc <stdio.h>.
  * Each porting layer supplies tm_putchar(int c) as the low-level
- * output bridge.
+ * output bridge.  TM_REPORT_DEFERRED holds each cycle's text back until
+ * the run ends.
  */
 
 #include <errno.h>
@@ -19,9 +20,13 @@
 #include <unistd.h>
 #endif
 #include "tm_api.h"
+#if defined(TM_VIRTUAL_TIME) || defined(TM_HOST_NOISE) || \
+    defined(TM_HOST_COUNTERS)
+#include "tm_host.h"
+#endif
 
 #ifdef TM_SEMIHOSTING
-/* Defined in ports/common/cortex-m/tm_putchar.c.  Direct SYS_EXIT
+/* Defined in ports/common/<arch>/tm_putchar.c.  Direct SYS_EXIT
  * semihosting call that bypasses newlib's _exit() and its deep
  * dependency chain (__sinit, _swiopen, etc.).
  */
@@ -32,6 +37,18 @@ void tm_semihosting_exit(int code);
 int tm_test_duration = TM_TEST_DURATION;
 int tm_test_cycles = TM_TEST_CYCLES;
 
+#ifdef TM_HOST_NOISE
+#ifndef TM_NOISE_RERUN
+#define TM_NOISE_RERUN 0
+#endif
+
+/* Noisy intervals that may still be rerun in this process, and whether
+ * the last interval was discarded.
+ */
+static int tm_noise_reruns = TM_NOISE_RERUN;
+static int tm_report_discarded;
+#endif
+
 /* Allow runtime override via environment variables on hosted
  * platforms.  On bare-metal (semihosting) targets getenv() is
  * unavailable, so the compile-time defaults are the only knob.
@@ -60,6 +77,17 @@ void tm_report_init(void)
             val <= INT_MAX)
             tm_test_cycles = (int) val;
     }
+
+#ifdef TM_HOST_NOISE
+    env = getenv("TM_NOISE_RERUN");
+    if (env) {
+        errno = 0;
+        val = strtol(env, &end, 10);
+        if (errno == 0 && end != env && *end == '\0' && val >= 0 &&
+            val <= INT_MAX)
+            tm_noise_reruns = (int) val;
+    }
+#endif
 #endif
 }
 
@@ -99,14 +127,105 @@ void tm_report_init_argv(int argc, char **argv)
 #endif
 }
 
-/* Print an unsigned long in decimal via tm_putchar(). */
+#ifdef TM_REPORT_DEFERRED
+#ifndef TM_REPORT_RECORDS
+#define TM_REPORT_RECORDS 8
+#endif
+#ifndef TM_REPORT_RECORD_SIZE
+#define TM_REPORT_RECORD_SIZE 1024
+#endif
+
+/* Deferred reporting: the text of each reporting cycle, up to and
+ * including its tm_report_period() line, is one record in this ring,
+ * and tm_report_finish() (or tm_check_fail()) writes the records out,
+ * so no measured interval contains console I/O.  Nothing is written
+ * early: once the ring is full the oldest record is dropped whole, and
+ * a record that outgrows its slot is cut short; the flush says so.
+ * Unbounded runs (tm_test_cycles == 0) never flush and print directly.
+ */
+static char tm_report_records[TM_REPORT_RECORDS][TM_REPORT_RECORD_SIZE];
+static unsigned int tm_report_length[TM_REPORT_RECORDS];
+static unsigned char tm_report_truncated[TM_REPORT_RECORDS];
+static unsigned long tm_report_closed;  /* records ever completed */
+static unsigned long tm_report_flushed; /* written out or dropped */
+static unsigned long tm_report_dropped;
+static int tm_report_direct; /* bypass the ring */
+
+static void tm_report_putc(int c)
+{
+    unsigned int r = tm_report_closed % TM_REPORT_RECORDS;
+
+    if (tm_report_direct || tm_test_cycles == 0) {
+        tm_putchar(c);
+        return;
+    }
+    if (tm_report_length[r] < TM_REPORT_RECORD_SIZE)
+        tm_report_records[r][tm_report_length[r]++] = (char) c;
+    else
+        tm_report_truncated[r] = 1;
+}
+
+/* Complete the open record and start the next one, dropping the oldest
+ * record if the ring has no free slot left for it.
+ */
+static void tm_report_close(void)
+{
+    unsigned int r;
+
+    tm_report_closed++;
+    if (tm_report_closed - tm_report_flushed > TM_REPORT_RECORDS - 1) {
+        tm_report_flushed++;
+        tm_report_dropped++;
+    }
+    r = tm_report_closed % TM_REPORT_RECORDS;
+    tm_report_length[r] = 0;
+    tm_report_truncated[r] = 0;
+}
+
+static void tm_report_write(unsigned int r)
+{
+    unsigned int i;
+
+    for (i = 0; i < tm_report_length[r]; i++)
+        tm_putchar(tm_report_records[r][i]);
+    if (tm_report_truncated[r]) {
+        if (i > 0 && tm_report_records[r][i - 1] != '\n')
+            tm_putchar('\n');
+        tm_report_direct = 1;
+        tm_printf("Deferred report: cycle text cut at %d bytes\n",
+                  TM_REPORT_RECORD_SIZE);
+        tm_report_direct = 0;
+    }
+    tm_report_length[r] = 0;
+    tm_report_truncated[r] = 0;
+}
+
+/* Write out the completed records, then the open one. */
+static void tm_report_flush(void)
+{
+    if (tm_report_dropped) {
+        tm_report_direct = 1;
+        tm_printf("Deferred report: %lu oldest cycles dropped\n",
+                  tm_report_dropped);
+        tm_report_direct = 0;
+        tm_report_dropped = 0;
+    }
+    while (tm_report_flushed != tm_report_closed)
+        tm_report_write(tm_report_flushed++ % TM_REPORT_RECORDS);
+    tm_report_write(tm_report_closed % TM_REPORT_RECORDS);
+}
+#else
+#define tm_report_putc(c) tm_putchar(c)
+#endif
+
+/* Print an unsigned long in decimal via tm_report_putc(). */
 static void tm_print_unsigned_long(unsigned long val)
 {
     char buf[21];
     int i = 0;
 
     if (val == 0) {
-        tm_putchar('0');
+        tm_report_putc('0');
         return;
     }
 
@@ -116,23 +235,38 @@ static void tm_print_unsigned_long(unsigned long val)
     }
 
     while (i > 0)
-        tm_putchar(buf[--i]);
+        tm_report_putc(buf[--i]);
 }
 
-/* Print a signed int in decimal via tm_putchar().
+/* Print an unsigned long in lowercase hex via tm_report_putc(). */
+static void tm_print_hex(unsigned long val)
+{
+    char buf[16];
+    int i = 0;
+
+    do {
+        buf[i++] = "0123456789abcdef"[val & 0xF];
+        val >>= 4;
+    } while (val > 0);
+
+    while (i > 0)
+        tm_report_putc(buf[--i]);
+}
+
+/* Print a signed int in decimal via tm_report_putc().
  * Negation is done in unsigned to avoid UB on INT_MIN.
  */
 static void tm_print_int(int val)
 {
     if (val < 0) {
-        tm_putchar('-');
+        tm_report_putc('-');
         tm_print_unsigned_long((unsigned long) (-(unsigned) val));
     } else {
         tm_print_unsigned_long((unsigned long) val);
     }
 }
 
-/* Tiny printf: handles %d, %lu, %s, %%.  C89 / freestanding-safe. */
+/* Tiny printf: handles %d, %lu, %lx, %s, %%.  C89 / freestanding-safe. */
 void tm_printf(const char *fmt, ...)
 {
     va_list ap;
@@ -142,7 +276,7 @@ void tm_printf(const char *fmt, ...)
 
     while (*fmt) {
         if (*fmt != '%') {
-            tm_putchar(*fmt++);
+            tm_report_putc(*fmt++);
             continue;
         }
         fmt++;
@@ -151,13 +285,15 @@ void tm_printf(const char *fmt, ...)
             fmt++;
             if (*fmt == 'u') {
                 tm_print_unsigned_long(va_arg(ap, unsigned long));
+            } else if (*fmt == 'x') {
+                tm_print_hex(va_arg(ap, unsigned long));
             } else {
                 /* Unknown %l_ combo -- print literal. */
-                tm_putchar('%');
-                tm_putchar('l');
+                tm_report_putc('%');
+                tm_report_putc('l');
                 if (*fmt == '\0')
                     goto done;
-                tm_putchar(*fmt);
+                tm_report_putc(*fmt);
             }
             break;
         case 'd':
@@ -168,16 +304,16 @@ void tm_printf(const char *fmt, ...)
             if (s == NULL)
                 s = "(null)";
             while (*s)
-                tm_putchar(*s++);
+                tm_report_putc(*s++);
             break;
         case '%':
-            tm_putchar('%');
+            tm_report_putc('%');
             break;
         case '\0':
             goto done;
         default:
-            tm_putchar('%');
-            tm_putchar(*fmt);
+            tm_report_putc('%');
+            tm_report_putc(*fmt);
             break;
         }
         fmt++;
@@ -186,8 +322,192 @@ done:
     va_end(ap);
 }
 
+/* Print a value given in hundredths with two decimals, e.g. 1203 as
+ * "12.03".  tm_printf() has no precision or padding support.
+ */
+void tm_print_fixed2(unsigned long hundredths)
+{
+    tm_print_unsigned_long(hundredths / 100);
+    tm_report_putc('.');
+    tm_report_putc('0' + (int) (hundredths % 100 / 10));
+    tm_report_putc('0' + (int) (hundredths % 10));
+}
+
+#ifdef TM_BOOT_TIME
+/* tm_timestamp() when the first benchmark thread ran.  The startup code
+ * started the counter at reset, so this is the cold-boot time.
+ */
+static unsigned long tm_boot_ticks;
+static int tm_boot_marked;
+
+void tm_report_boot_mark(void)
+{
+    if (!tm_boot_marked) {
+        tm_boot_ticks = tm_timestamp();
+        tm_boot_marked = 1;
+    }
+}
+
+/* Under -icount virtual time advances 2^TM_ICOUNT_SHIFT ns per guest
+ * instruction, which turns the tick count into an instruction count.
+ */
+static void tm_report_boot(void)
+{
+    unsigned long long ticks = tm_boot_ticks;
+    unsigned long freq = tm_timestamp_frequency();
+
+    tm_printf("Boot time:  %lu us (%lu timer ticks)\n",
+              (unsigned long) (ticks * 1000000ULL / freq),
+              (unsigned long) ticks);
+#ifdef TM_ICOUNT_SHIFT
+    tm_printf("Boot instructions:  %lu\n",
+              (unsigned long) (ticks * 1000000000ULL /
+                               ((unsigned long long) freq << TM_ICOUNT_SHIFT)));
+#endif
+}
+#endif
+
+/* Mark the start of the first measured interval.  Called once by
+ * TM_REPORT_LOOP before the reporter first sleeps.
+ */
+void tm_report_start(void)
+{
+#ifdef TM_BOOT_TIME
+    tm_report_boot();
+#endif
+#ifdef TM_VIRTUAL_TIME
+    tm_vtime_mark();
+#endif
+#ifdef TM_HOST_NOISE
+    tm_noise_start();
+#endif
+#ifdef TM_HOST_COUNTERS
+    tm_counters_start();
+#endif
+}
+
+#ifdef TM_ICOUNT_SHIFT
+/* QEMU -icount: an interval of tm_test_duration virtual seconds is a
+ * budget of tm_test_duration * 10^9 / 2^TM_ICOUNT_SHIFT instructions
+ * (the benchmark threads never idle, so virtual time never skips
+ * ahead).  Normalizing to that budget gives a host-independent rate.
+ */
+static void tm_report_icount(unsigned long total)
+{
+    unsigned long long kinsns, hundredths;
+
+    kinsns = ((unsigned long long) tm_test_duration * 1000000ULL) >>
+             TM_ICOUNT_SHIFT;
+    if (kinsns == 0)
+        return;
+    hundredths = (unsigned long long) total * 100000ULL / kinsns;
+    tm_printf("Ops per million instructions:  ");
+    tm_print_fixed2((unsigned long) hundredths);
+    tm_printf("\n");
+}
+#endif
+
+/* Default for ports without run statistics. */
+__attribute__((weak)) void tm_port_report(void) {}
+
+/* Default for ports that cannot measure stack usage. */
+__attribute__((weak)) int tm_thread_stack_usage(int thread_id,
+                                                unsigned long *used,
+                                                unsigned long *size)
+{
+    (void) thread_id;
+    (void) used;
+    (void) size;
+    return TM_ERROR;
+}
+
+/* Thread ids probed for stack usage; above every port's thread table. */
+#define TM_REPORT_MAX_THREADS 32
+
+/* Peak stack usage of every thread the test created. */
+static void tm_report_stacks(void)
+{
+    unsigned long used, size;
+    int i;
+
+    for (i = 0; i < TM_REPORT_MAX_THREADS; i++) {
+        if (tm_thread_stack_usage(i, &used, &size) != TM_SUCCESS)
+            continue;
+        tm_printf("Thread %d stack: %lu of %lu bytes used\n", i, used, size);
+    }
+}
+
+/* Close the current reporting interval and print its total, preceded by
+ * the port's cumulative run statistics and peak stack usage.  In
+ * virtual-time builds the raw count is normalised to exactly one
+ * interval's worth of instructions; the raw value is shown alongside.
+ */
+void tm_report_period(unsigned long total)
+{
+#ifdef TM_VIRTUAL_TIME
+    unsigned long insns;
+#endif
+
+#ifdef TM_HOST_COUNTERS
+    tm_counters_report(total);
+#endif
+#ifdef TM_VIRTUAL_TIME
+    if (tm_vtime_active()) {
+        insns = tm_vtime_mark();
+        tm_printf("Virtual Time:  %lu M instructions, raw total %lu\n",
+                  insns, total);
+        total = tm_vtime_scale(total);
+    }
+#endif
+#ifdef TM_HOST_NOISE
+    /* A noisy interval is printed under a different label so parsers
+     * that average "Time Period Total" lines never see it, and is not
+     * counted towards tm_test_cycles.  Once the rerun budget is spent
+     * the result is kept but marked unreliable.
+     */
+    tm_report_discarded = 0;
+    if (tm_noise_check()) {
+        if (tm_noise_reruns > 0) {
+            tm_noise_reruns--;
+            tm_report_discarded = 1;
+            tm_printf("Discarded Period Total:  %lu (host noise, rerunning)"
+                      "\n\n",
+                      total);
+#ifdef TM_REPORT_DEFERRED
+            tm_report_close();
+#endif
+            return;
+        }
+        tm_printf("WARNING: host noise above threshold, result unreliable\n");
+    }
+#endif
+#ifdef TM_ICOUNT_SHIFT
+    tm_report_icount(total);
+#endif
+    tm_port_report();
+    tm_report_stacks();
+    tm_printf("Time Period Total:  %lu\n\n", total);
+#ifdef TM_REPORT_DEFERRED
+    tm_report_close();
+#endif
+}
+
+/* 0 if the interval just reported was discarded for a rerun. */
+int tm_report_counted(void)
+{
+#ifdef TM_HOST_NOISE
+    return !tm_report_discarded;
+#else
+    return 1;
+#endif
+}
+
 void tm_report_finish(void)
 {
+#ifdef TM_REPORT_DEFERRED
+    tm_report_flush();
+#endif
+
     /* POSIX: exit() flushes stdio and runs atexit handlers (sanitizers
      * register theirs via atexit).  Semihosting: direct SYS_EXIT
      * bypasses newlib's _exit() which pulls in __sinit and file I/O
@@ -202,6 +522,9 @@ void tm_report_finish(void)
 
 void tm_check_fail(const char *msg)
 {
+#ifdef TM_REPORT_DEFERRED
+    tm_report_flush();
+#endif
     while (*msg)
         tm_putchar(*msg++);
     /* See tm_report_finish() for the POSIX vs semihosting rationale. */